@@ -3,21 +3,65 @@
  * 
  * <David Martin dama7453>
  */
+#define _GNU_SOURCE         /* pipe2, F_SETPIPE_SZ */
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <errno.h>
+#include <time.h>
+#include <stdint.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/resource.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+#include <termios.h>
+#include <dirent.h>
+#include <sched.h>
 
 /* Misc manifest constants */
 #define MAXLINE    1024   /* max line size */
 #define MAXARGS     128   /* max args on a command line */
-#define MAXJOBS      16   /* max jobs at any point in time */
-#define MAXJID    1<<16   /* max job ID */
+#define MAXJOBS      16   /* initial job table size (it grows) */
+#ifndef MAXJID
+#define MAXJID  (1<<16)   /* max job ID (make test33 builds with a small one) */
+#endif
+#define JIDWORDS (MAXJID/64 + 1) /* words in the job ID bitmap */
+#define PIDTOMB      -2   /* pid index entry of a removed job */
+#define MAXCMDS (MAXARGS/2) /* max commands in a pipeline */
+#define MAXREDIRS (MAXARGS/2) /* max redirections on a command line */
+#define STRMIN       32   /* smallest job arena block */
+#define STRCLASSES    6   /* block sizes STRMIN, 2*STRMIN, ... MAXLINE */
+#define STRCHUNK  65536   /* bytes the arena grabs from malloc at a time */
+#define HASHSIZE    256   /* buckets in the command hash table */
+#define BLTNSLOTS    32   /* slots in the builtin table's perfect hash */
+#define VARHASH      64   /* buckets in the shell variable table */
+#define HISTDEPTH    16   /* bytes of each history entry the trie indexes */
+#define DENTBUF   32768   /* bytes of directory entries read at a time */
+#define GLOBHASH     64   /* buckets in the glob directory cache */
+#define GLOBDIRS    256   /* directories cached before the cache is emptied */
+#define OUTBUF    65536   /* captured output kept in memory before spilling */
+#define MAXCOMPLETE 100   /* completions listed before just counting them */
+#define TOKCHUNK  65536   /* bytes in a token arena chunk */
+#define INBUF     65536   /* initial size of the input buffer */
+#define TRACESIZE  4096   /* events kept in the trace ring */
+#define TRACEBUCKETS 24   /* power-of-two latency histogram buckets */
+#define TICKMS       10   /* timer wheel resolution in ms */
+#define WHEELBITS     6   /* log2 of the slots per wheel level */
+#define WHEELSLOTS (1 << WHEELBITS)
+#define WHEELLEVELS   4   /* 64^4 ticks of 10 ms: about 19 days */
 
 /* Job states */
 #define UNDEF 0 /* undefined */
@@ -25,6 +69,13 @@
 #define BG 2    /* running in background */
 #define ST 3    /* stopped */
 
+/* Redirection operators */
+#define R_IN 0      /* [n]< file */
+#define R_OUT 1     /* [n]> file */
+#define R_APPEND 2  /* [n]>> file */
+#define R_DUP 3     /* [n]>&m */
+#define R_HERESTR 4 /* [n]<<< word */
+
 /* Builtin types */
 #define BLTN_UNK 0
 #define BLTN_IGNR 1
@@ -32,6 +83,59 @@
 #define BLTN_JOBS 3
 #define BLTN_EXIT 4
 #define BLTN_KILLALL 5
+#define BLTN_HASH 6
+#define BLTN_PARALLEL 7
+#define BLTN_TRACE 8
+#define BLTN_ECHO 9
+#define BLTN_PRINTF 10
+#define BLTN_TRUE 11
+#define BLTN_FALSE 12
+#define BLTN_TEST 13
+#define BLTN_CD 14
+#define BLTN_PWD 15
+#define BLTN_HISTORY 16
+#define BLTN_EXPORT 17
+#define BLTN_UNSET 18
+#define BLTN_OUTPUT 19
+
+/* Token types */
+#define T_WORD  0   /* a word, quotes and escapes removed */
+#define T_PIPE  1   /* | */
+#define T_AMP   2   /* & */
+#define T_SEMI  3   /* ; */
+#define T_REDIR 4   /* [n]< [n]> [n]>> [n]>&m [n]<<< */
+
+/* Word flags */
+#define TF_QUOTED 1 /* some of the word was quoted or escaped */
+#define TF_GLOB   2 /* it has an unquoted *, ? or [ */
+#define TF_ASSIGN 4 /* it starts with an unquoted NAME= */
+#define TF_EXPANDED 8 /* some of it came from a $ expansion */
+#define TF_QGLOB 16 /* it has a quoted or escaped *, ? or [ */
+
+/* Lifecycle trace events */
+#define TE_PARSE   0  /* a command line was tokenized */
+#define TE_FORK    1  /* a child was forked (or spawned, with -s) */
+#define TE_EXEC    2  /* a forked child got as far as exec */
+#define TE_STOP    3  /* a job was seen to stop */
+#define TE_CONT    4  /* a stopped job was sent SIGCONT */
+#define TE_REAP    5  /* a child was reaped */
+#define TE_BUILTIN 6  /* a builtin command ran */
+#define TE_NTYPES  7
+
+/* Job flags */
+#define JF_PARALLEL 1 /* worker started by the parallel builtin */
+#define JF_TIMED    2 /* report resource usage when done (time builtin) */
+#define JF_TEARDOWN 4 /* signalled by killall, not reaped yet */
+
+/* What a job's scheduling attributes set */
+#define SC_CPUS   1   /* its CPU affinity */
+#define SC_NICE   2   /* its nice value */
+#define SC_POLICY 4   /* its scheduling policy */
+#define SC_NODES  8   /* the memory nodes it allocates from */
+
+#ifndef PIDFD_SIGNAL_PROCESS_GROUP
+#define PIDFD_SIGNAL_PROCESS_GROUP (1 << 2) /* pidfd_send_signal to the group */
+#endif
 
 /* 
  * Jobs states: FG (foreground), BG (background), ST (stopped)
@@ -47,50 +151,571 @@
 extern char **environ;      /* defined in libc */
 char prompt[] = "tsh> ";    /* command line prompt (DO NOT CHANGE) */
 int verbose = 0;            /* if true, print additional output */
-int nextjid = 1;            /* next job ID to allocate */
+int use_spawn = 0;          /* if true, launch jobs with posix_spawn */
+int capture = 0;            /* if true, keep background jobs' output (-o) */
+int pipesize = 0;           /* if nonzero, F_SETPIPE_SZ for pipeline pipes */
 char sbuf[MAXLINE];         /* for composing sprintf messages */
+int laststatus = 0;         /* exit status of the last foreground command */
+const char *shname = "tsh"; /* $0: how tsh was run, or the script it runs */
+
+struct fgstats_t {          /* foreground wakeup latency counters */
+    long waits;             /* number of completed foreground waits */
+    long total_ns;          /* sum of job-change -> waitfg-return latencies */
+    long max_ns;            /* worst single latency */
+};
+sigset_t jobsigs;           /* signals read by the event loop, never delivered */
+sigset_t shellmask;         /* signal mask the shell started with */
+struct fgstats_t fgstats;   /* updated by waitfg */
+struct timespec fg_changed; /* when sigchld_handler last changed the FG job */
+
+struct parallel_t {         /* State of a running parallel builtin */
+    int limit;              /* workers allowed in flight, 0 if not running */
+    int running;            /* workers started but not reaped */
+    int interrupted;        /* ctrl-c arrived */
+    long started;           /* workers launched */
+    long finished;          /* workers reaped */
+    long total_ns;          /* sum of launch -> reap times */
+    long max_ns;            /* slowest worker */
+};
+struct parallel_t par;      /* updated by sigchld_handler */
+
+struct tevent_t {           /* One lifecycle trace event */
+    long ns;                /* CLOCK_MONOTONIC time it was recorded */
+    long dur_ns;            /* how long the phase it ends took */
+    pid_t pid;              /* process involved, 0 if none */
+    int jid;                /* job involved, 0 if none */
+    int type;               /* TE_PARSE ... TE_BUILTIN */
+};
+struct trace_t {            /* Lifecycle tracing (-v or "trace on") */
+    int on;                 /* events are being recorded */
+    FILE *out;              /* file the ring is flushed to, or NULL */
+    long head;              /* events recorded so far */
+    long flushed;           /* events written to out so far */
+    struct tevent_t ring[TRACESIZE]; /* the last TRACESIZE events */
+    struct phase_t {        /* running totals for one event type */
+        long n;             /* events */
+        long total_ns;      /* sum of their durations */
+        long max_ns;        /* longest */
+        long hist[TRACEBUCKETS]; /* counts by power-of-two microseconds */
+    } phase[TE_NTYPES];
+};
+struct trace_t trace;
+long sigread_ns;            /* when sig_ready last read the signalfd */
+const char *tenames[TE_NTYPES] = {
+    "parse", "fork", "exec", "stop", "cont", "reap", "builtin"
+};
+
+struct evsrc_t {            /* A descriptor watched by the event loop */
+    int fd;                 /* the descriptor, -1 once removed */
+    void (*fn)(struct evsrc_t *src); /* called when it is ready */
+    void *arg;              /* for fn */
+    struct evsrc_t *next;   /* on the list of removed sources */
+};
+int evfd = -1;              /* epoll instance of the event loop */
+int sigfd = -1;             /* signalfd for jobsigs */
+int untracked;              /* job processes without a pidfd */
+
+struct outbuf_t {           /* A background job's captured stdout */
+    int jid;                /* the job it came from */
+    pid_t pgid;             /* and that job's process group */
+    int fd;                 /* read end of the job's pipe, -1 at EOF */
+    struct evsrc_t *src;    /* fd on the event loop */
+    char *buf;              /* the first OUTBUF bytes */
+    size_t len;             /* bytes captured so far */
+    int spill;              /* unlinked file with all of it, once past OUTBUF */
+    size_t dropped;         /* bytes thrown away when the file failed */
+    struct outbuf_t *next;
+};
+struct outbuf_t *outbufs;   /* captured output, until another captured job takes its ID */
+int following;              /* output -f is running; ctrl-c clears it */
+int evdepth;                /* ev_wait calls in progress */
+struct evsrc_t *evdead;     /* removed sources, freed when evdepth is 0 */
+
+struct input_t {            /* Line reader for the shell's input */
+    int fd;                 /* descriptor read from */
+    struct evsrc_t *src;    /* its event source, NULL if it can't be polled */
+    int ready;              /* src reported readable since the last read */
+    int eof;                /* read returned 0 */
+    int tty;                /* fd is a terminal */
+    char *buf;              /* size bytes, plus room for a "\n\0" */
+    size_t size;            /* grown to fit the longest line */
+    size_t start, end;      /* unread input is buf[start, end) */
+    char *held;             /* the NUL ending the line last returned */
+    char saved;             /* the byte it replaced */
+};
+struct input_t input;       /* the shell's stdin */
+
+struct histnode_t {         /* A node of the history prefix trie */
+    int child, sibling;     /* first child and next sibling, 0 for none */
+    long last;              /* latest entry at or below this node */
+    unsigned char c;        /* the byte leading here */
+};
+
+struct hist_t {             /* Command history, kept in a file */
+    int fd;                 /* the file, opened O_APPEND; -1 if none */
+    char *file;
+    char *map;              /* the file, mapped */
+    size_t mapsize;
+    size_t indexed;         /* bytes of the map indexed, whole lines */
+    long nents, entcap;     /* entries indexed */
+    size_t *off;            /* entry -> offset of its line */
+    long *chain;            /* entry -> previous one ending at its trie node */
+    struct histnode_t *nodes; /* trie of the entries' first HISTDEPTH bytes */
+    int nnodes, nodecap;
+    char *line;             /* the line hist_expand made */
+    size_t linesize;
+};
+struct hist_t hist = { .fd = -1 };
+
+struct edit_t {             /* Line editing on a terminal */
+    int on;                 /* saved holds the terminal's own settings */
+    int raw;                /* ours are in effect */
+    struct termios saved;
+    const char *prompt;     /* redrawn after listing completions */
+    char *line;             /* the line being edited */
+    size_t len, cap;
+    size_t out;             /* bytes of a finished line handed out */
+    char keys[64];          /* keys read, keys[key, nkeys) not handled yet */
+    int key, nkeys;
+    int esc;                /* 1 after ESC, 2 inside an escape sequence */
+};
+struct edit_t edit;
+
+struct wheel_t {            /* Hierarchical timer wheel on a timerfd */
+    int tfd;                /* timerfd ticking while timers are pending */
+    struct timespec base;   /* CLOCK_MONOTONIC time of tick 0 */
+    uint64_t now;           /* last tick processed */
+    int pending;            /* timers on the wheel */
+    struct wtimer_t *slot[WHEELLEVELS][WHEELSLOTS];
+};
+struct wheel_t wheel;
+
+struct sched_t {            /* Where and how a job's processes run */
+    int set;                /* SC_* for the attributes given */
+    cpu_set_t cpus;         /* CPUs they may run on */
+    int nice;               /* nice value */
+    int policy;             /* SCHED_OTHER, SCHED_BATCH or SCHED_IDLE */
+    unsigned long nodes;    /* memory nodes they are bound to, as bits */
+};
+
+struct jobopts_t {          /* How eval_job should start a job */
+    int flags;              /* JF_* flags */
+    long timeout_ms;        /* SIGINT the job after this long, if nonzero */
+    long killafter_ms;      /* then SIGKILL it this much later, if nonzero */
+    struct sched_t sched;   /* applied in each child before exec */
+};
+
+struct spread_t {           /* Round-robin placement of background jobs */
+    int on;
+    cpu_set_t cpus;         /* the shell's own CPUs when it was turned on */
+    int next;               /* the CPU the next job gets */
+};
+struct spread_t spread;
+
+struct wtimer_t {           /* A timer on the timer wheel */
+    uint64_t expires;       /* tick at which fn runs */
+    struct wtimer_t *next;  /* in its wheel slot */
+    struct wtimer_t **pprev; /* link pointing at us, NULL if not pending */
+    void (*fn)(struct wtimer_t *t); /* called on expiry, may re-add t */
+};
+
+struct jobtimer_t {         /* A job's deadline */
+    struct wtimer_t t;      /* must be first */
+    pid_t pgid;             /* the job, by process group */
+    long killafter_ms;      /* escalate to SIGKILL this much later */
+};
+
+struct wtimer_t killall_timer; /* deadline set by killall */
+
+struct teardown_t {         /* A killall in progress */
+    int active;             /* groups were signalled and not all are gone */
+    int left;               /* JF_TEARDOWN jobs not reaped yet */
+    int killed;             /* groups that needed the SIGKILL */
+    int expired;            /* the grace period is over */
+    int njobs;              /* jobs signalled */
+    int n, cap;             /* entries used and allocated in pgids */
+    pid_t *pgids;           /* signalled groups not yet found empty */
+    long grace_ms;          /* how long SIGINT gets before SIGKILL */
+    struct timespec start;  /* when the groups were signalled */
+    struct wtimer_t grace;  /* fires at the end of the grace period */
+};
+struct teardown_t teardown = { .grace_ms = 1000 };
+
+struct usage_t {            /* Resources used by a job's processes */
+    long utime_us;          /* user CPU time */
+    long stime_us;          /* system CPU time */
+    long maxrss;            /* largest resident set of any process, in KB */
+    long nvcsw;             /* voluntary context switches */
+    long nivcsw;            /* involuntary context switches */
+};
 
 struct job_t {              /* The job struct */
-    pid_t pid;              /* job PID */
+    pid_t pid;              /* job PID (and process group of the job) */
     int jid;                /* job ID [1, 2, ...] */
     int state;              /* UNDEF, BG, FG, or ST */
-    char cmdline[MAXLINE];  /* command line */
+    int nprocs;             /* processes in the job (pipeline stages) */
+    int nlive;              /* processes not reaped yet */
+    int termsig;            /* signal that killed a process, if any */
+    int flags;              /* JF_* flags */
+    struct timespec start;  /* when the job was added */
+    struct usage_t usage;   /* totals for the processes reaped so far */
+    struct jobtimer_t *deadline; /* pending timeout, if any */
+    int cmdlen;             /* strlen(cmdline) */
+    char *cmdline;          /* command line, held in the job arena */
+    pid_t *procs;           /* member PIDs (0 once reaped), in the job arena */
+    struct evsrc_t **pidfds; /* members' pidfds on the event loop (NULL once
+				reaped, or if they have none), in the job arena */
+};
+
+struct redir_t {            /* One I/O redirection */
+    int op;                 /* R_IN, R_OUT, R_APPEND, R_DUP or R_HERESTR */
+    int fd;                 /* descriptor being redirected */
+    char *target;           /* file name, descriptor number or here-string */
+    int herefd;             /* read end of a loaded here-string pipe */
+};
+struct cmd_t {              /* One command of a pipeline */
+    char **argv;            /* its arguments, NULL terminated */
+    char **assigns;         /* NAME=value words before them */
+    int nassigns;
+    struct redir_t *redirs; /* its redirections, applied in order */
+    int nredirs;            /* number of redirections */
+};
+struct tok_t {              /* One token of a command line */
+    char *s;                /* its text, NUL terminated, in the token arena */
+    int type;               /* T_* */
+    int flags;              /* TF_* for words */
+    size_t start, end;      /* the bytes of the line it came from */
+    struct tok_t *next;     /* the next token, NULL at the end */
+};
+struct tokchunk_t {         /* A block of the token arena */
+    struct tokchunk_t *next; /* the next block, kept for reuse */
+    size_t size, used;      /* bytes in data and bytes handed out */
+    char data[];
+};
+struct tokmark_t {          /* A point the token arena can be reset to */
+    struct tokchunk_t *chunk;
+    size_t used;
+};
+struct pipeline_t {         /* A parsed command line */
+    struct cmd_t cmds[MAXCMDS]; /* the commands, connected by pipes */
+    int ncmds;              /* number of commands */
+    struct redir_t redirs[MAXREDIRS]; /* redirections of all commands */
+    int nredirs;            /* entries used in redirs */
+};
+
+struct arena_t {            /* Size-class arena for job command lines and PID lists */
+    char *freelist[STRCLASSES]; /* freed blocks, linked through their first bytes */
+    char *chunk;            /* unused tail of the newest chunk */
+    size_t left;            /* bytes remaining in chunk */
+};
+struct arena_t cmdarena;
+struct tokchunk_t *tokcur;  /* token arena chunk being allocated from */
+
+struct joblist_t {          /* The job table */
+    struct job_t *slot;     /* job records, cap of them */
+    int cap;                /* allocated slots */
+    int count;              /* slots in use */
+    int *freeslot;          /* stack of unused slot indexes */
+    int nfree;              /* entries on the freeslot stack */
+    struct pident_t {       /* open-addressed PID -> slot index */
+        pid_t pid;          /* a process belonging to a job */
+        int slot;           /* its job's slot, -1 if unused, or PIDTOMB */
+    } *pidtab;
+    int pidmask;            /* pidtab size - 1 (a power of two) */
+    int npids;              /* PIDs indexed */
+    int tombs;              /* PIDTOMB entries in pidtab */
+    int *jidslot;           /* job ID -> slot index */
+    int jidcap;             /* entries in jidslot */
+    uint64_t jidmap[JIDWORDS]; /* bitmap of job IDs in use */
+    int maxjid;             /* largest job ID in use */
+    int fg;                 /* slot of the FG job, -1 if none */
+};
+struct joblist_t joblist;
+struct joblist_t *jobs = &joblist; /* The job list */
+
+struct var_t {              /* A shell variable */
+    char *str;              /* "NAME=value", as the environment has it */
+    size_t namelen;
+    int exported;           /* it goes in the environment */
+    int owned;              /* str was allocated here, not inherited */
+    struct var_t *next;     /* next in the same bucket */
+};
+
+struct builtin_t {          /* A command the shell runs itself */
+    const char *name;
+    int type;               /* BLTN_* */
+    int utility;            /* 1: a utility run in the foreground; 2: also /bin/name */
+};
+unsigned char bltnslot[BLTNSLOTS]; /* name hash -> builtins index + 1 */
+
+struct pathent_t {          /* A remembered command location */
+    char *name;             /* command name as typed */
+    char *path;             /* absolute path it resolved to */
+    long hits;              /* times the entry was used */
+    struct pathent_t *next; /* next entry in the same bucket */
+};
+struct dirlist_t {          /* The names in a directory, read in bulk */
+    char *names;            /* each name's d_type byte, then the name */
+    char **sorted;          /* pointers to the names, in strcmp order */
+    int count;
+};
+
+struct pathdir_t {          /* A PATH directory we resolved against */
+    char *dir;              /* directory name ("." for empty entries) */
+    struct timespec mtime;  /* its mtime when the table was filled */
+    int wd;                 /* its inotify watch, -1 to stat it instead */
+    int listed;             /* list holds what is in it now */
+    struct dirlist_t list;  /* its catalog of commands */
 };
-struct job_t jobs[MAXJOBS]; /* The job list */
+struct globdir_t {          /* A directory listing kept for globbing */
+    char *dir;              /* the directory, as the pattern named it */
+    dev_t dev;              /* what it was when it was read */
+    ino_t ino;
+    struct timespec mtime;
+    int racy;               /* it was read within a second of a change */
+    struct dirlist_t list;
+    struct globdir_t *next; /* next entry in the same bucket */
+};
+struct globv_t {            /* The paths a pattern matched */
+    char **v;
+    int n, cap;
+};
+struct var_t *vartab[VARHASH]; /* shell variables */
+char **envp;                /* the exported ones, as execve wants them */
+int envdirty;               /* envp doesn't match the variables any more */
+int envcap;                 /* entries allocated for envp, 0 if it's libc's */
+char **envstale;            /* replaced strings envp may still point at */
+int nenvstale, envstalecap;
+
+struct pathent_t *pathtab[HASHSIZE]; /* command name -> path */
+struct pathdir_t *pathdirs; /* PATH split into directories */
+int npathdirs;              /* number of entries in pathdirs */
+char *pathstr;              /* value of PATH pathdirs was built from */
+int inofd = -1;             /* inotify watching pathdirs; -2 if unavailable */
+struct globdir_t *globtab[GLOBHASH]; /* directory -> its cached listing */
+int nglobdirs;              /* directories in globtab */
 /* End global variables */
 
 
 /* Function prototypes */
 
 /* Here are the functions that you will implement */
-void eval(char *cmdline);
-int is_builtin_cmd(char **argv);
+void eval(char *cmdline, size_t len);
+int eval_job(char *cmdline, size_t len, const struct jobopts_t *opts);
+int eval_seg(char *line, size_t len, struct tok_t *first, struct tok_t *end,
+	     const struct jobopts_t *opts);
+int tokenize(char *line, size_t len, struct tok_t **toks);
+int redirscan(const char *p, const char *lim);
+struct tokmark_t tokmark(void);
+void tokrelease(struct tokmark_t mark);
+void *tokalloc(size_t size);
+char *tokreserve(size_t size);
+int is_builtin_cmd(char **argv, int type);
 void do_exit(void);
-void do_show_jobs(void);
+void do_show_jobs(char **argv);
+int do_time(char *line, size_t len, struct tok_t *t, struct tok_t *end,
+	    const struct jobopts_t *opts);
+int do_timeout(char *line, size_t len, struct tok_t *t, struct tok_t *end,
+	       const struct jobopts_t *opts);
+int do_pin(char *line, size_t len, struct tok_t *t, struct tok_t *end,
+	   const struct jobopts_t *opts);
+int do_sched(char *line, size_t len, struct tok_t *t, struct tok_t *end,
+	     const struct jobopts_t *opts);
+int cpulist(const char *s, cpu_set_t *set, int usable);
+int sched_apply(const struct sched_t *sc);
 void do_ignore_singleton(void);
 void do_killall(char **argv);
+void teardown_start(void);
+void teardown_reaped(void);
+void teardown_grace(struct wtimer_t *t);
+int teardown_alive(void);
+int teardown_probe(int i);
+void teardown_jobgone(pid_t pgid);
+void teardown_finish(void);
 void do_bgfg(char **argv);
+void do_hash(char **argv);
+void do_parallel(char **argv);
+void do_trace(char **argv);
+void do_echo(char **argv);
+void do_printf(char **argv);
+void do_test(char **argv);
+int testexpr(char **argv, int argc);
+int testor(char **argv, int argc, int *i);
+int testand(char **argv, int argc, int *i);
+int testnot(char **argv, int argc, int *i);
+int testprim(char **argv, int argc, int *i);
+int testbinop(const char *op);
+int testunary(const char *op, const char *arg);
+int testbinary(const char *x, const char *op, const char *y);
+void do_cd(char **argv);
+void do_pwd(char **argv);
+void do_history(char **argv);
+void do_export(char **argv);
+void do_unset(char **argv);
+void do_output(char **argv);
+void parallel_one(char *cmdline, size_t len);
+void waitslots(int most);
 void waitfg(pid_t pid);
+void ev_init(void);
+struct evsrc_t *ev_add(int fd, int events, void (*fn)(struct evsrc_t *),
+		       void *arg);
+int ev_mod(struct evsrc_t *src, int events);
+void ev_del(struct evsrc_t *src);
+int ev_wait(int timeout);
+void sig_ready(struct evsrc_t *src);
+void proc_ready(struct evsrc_t *src);
+void input_init(struct input_t *in, int fd);
+void input_ready(struct evsrc_t *src);
+char *input_line(struct input_t *in, size_t *len);
+char *input_rest(struct input_t *in, size_t *size);
+ssize_t input_read(struct input_t *in, char *dst, size_t room);
+ssize_t input_fetch(struct input_t *in, char *dst, size_t room);
+ssize_t edit_read(struct input_t *in, char *dst, size_t room);
+int edit_key(char c);
+void edit_insert(const char *s, size_t n);
+void edit_erase(size_t n);
+void edit_echo(const char *s, size_t n);
+void edit_complete(void);
+void edit_reset(void);
+void wheel_init(void);
+uint64_t wheel_clock(void);
+void wheel_ready(struct evsrc_t *src);
+void wheel_arm(int on);
+void wt_insert(struct wtimer_t *t);
+void wt_add(struct wtimer_t *t, long ms);
+void wt_cancel(struct wtimer_t *t);
+void report_fgstats(void);
+long mono_ns(void);
+void trace_event(int type, pid_t pid, int jid, long dur_ns);
+void trace_write(FILE *fp, long from, long to);
+void trace_flush(void);
+void trace_stats(void);
+void run_script(const char *file);
+void eval_lines(char *buf, size_t size, void (*fn)(char *cmdline, size_t len));
+int parsepipeline(struct tok_t *first, struct tok_t *end,
+		  struct pipeline_t *pl);
+int redirop(const char *arg, struct redir_t *r);
+int prepare_redirs(struct cmd_t *cmd);
+void release_redirs(struct cmd_t *cmd);
+int here_feeder(int fds[2], const char *text, size_t len);
+int open_redir(struct redir_t *r, int *opened);
+int apply_redirs(struct cmd_t *cmd);
+void save_redirs(struct cmd_t *cmd, int *saved);
+void restore_redirs(struct cmd_t *cmd, int *saved);
+int launch_job(struct pipeline_t *pl, int bg, char *cmdline,
+	       const struct jobopts_t *opts);
+pid_t launch_cmd(struct cmd_t *cmd, pid_t pgid, int infd, int outfd,
+		 const sigset_t *mask, const struct sched_t *sc);
+pid_t spawn_job(struct cmd_t *cmd, const char *path, pid_t pgid, int infd,
+		int outfd, const sigset_t *mask);
 
 void sigchld_handler(int sig);
+void child_stopped(pid_t pid, int sig);
+void child_reaped(pid_t pid, int status, struct rusage *ru);
 void sigtstp_handler(int sig);
 void sigint_handler(int sig);
-void sigalrm_handler(int sig);
+void killall_expire(struct wtimer_t *t);
+void job_expire(struct wtimer_t *t);
+void parallel_done(struct job_t *job);
 
 /* Here are helper routines that we've provided for you */
-int parseline(const char *cmdline, char **argv); 
 void sigquit_handler(int sig);
 
 void clearjob(struct job_t *job);
-void initjobs(struct job_t *jobs);
-int maxjid(struct job_t *jobs); 
-int addjob(struct job_t *jobs, pid_t pid, int state, char *cmdline);
-int removejob(struct job_t *jobs, pid_t pid); 
-pid_t fgpid(struct job_t *jobs);
-struct job_t *getprocessid(struct job_t *jobs, pid_t pid);
-struct job_t *getjobid(struct job_t *jobs, int jid); 
+void initjobs(struct joblist_t *jobs);
+int growjobs(struct joblist_t *jobs);
+int growpids(struct joblist_t *jobs, int more);
+int pidprobe(struct joblist_t *jobs, pid_t pid);
+void pidinsert(struct joblist_t *jobs, pid_t pid, int s);
+void piddelete(struct joblist_t *jobs, pid_t pid);
+int nextfreejid(struct joblist_t *jobs);
+int maxjid(struct joblist_t *jobs); 
+int addjob(struct joblist_t *jobs, pid_t pid, int state, char *cmdline);
+int addjobprocs(struct joblist_t *jobs, pid_t *pids, int n, int state,
+		char *cmdline);
+struct job_t *procdone(struct joblist_t *jobs, pid_t pid);
+struct evsrc_t *pidfd_watch(pid_t pid);
+void pidfd_close(struct job_t *job, int i);
+int job_kill(struct job_t *job, int sig);
+int removejob(struct joblist_t *jobs, pid_t pid); 
+void setjobstate(struct joblist_t *jobs, struct job_t *job, int state);
+pid_t fgpid(struct joblist_t *jobs);
+struct job_t *getprocessid(struct joblist_t *jobs, pid_t pid);
+struct job_t *getjobid(struct joblist_t *jobs, int jid); 
 int get_jid_from_pid(pid_t pid); 
-void showjobs(struct job_t *jobs);
+void showjobs(struct joblist_t *jobs);
+void showjobs_long(struct joblist_t *jobs);
+
+void addusage(struct usage_t *u, const struct rusage *ru);
+void procusage(pid_t pid, struct usage_t *u);
+long elapsed_ns(const struct timespec *since);
+void fmtusage(char *buf, size_t size, const struct usage_t *u, long wall_ns);
+
+int strclass(size_t size);
+void *blkalloc(struct arena_t *a, size_t size);
+void blkfree(struct arena_t *a, void *blk, size_t size);
+char *stralloc(struct arena_t *a, const char *str, int len);
+void strfree(struct arena_t *a, char *str, int len);
+
+void bltn_init(void);
+unsigned bltnhash(const char *name, size_t len);
+int builtin_lookup(const char *name, int bg);
+int unescape(const char *s, int zerolead, char *c);
+int putescaped(const char *s, int zerolead);
+void numcheck(const char *arg, const char *end);
+long long intarg(const char *a);
+unsigned long long uintarg(const char *a);
+double floatarg(const char *a);
+char *shquote(const char *s);
+
+void var_init(void);
+unsigned varhash(const char *name, size_t len);
+struct var_t *var_find(const char *name, size_t len);
+char *var_get(const char *name);
+int var_set(const char *name, size_t len, const char *value, int export);
+void var_unset(const char *name);
+void var_retire(struct var_t *v);
+int var_name(const char *name, size_t len);
+char **env_get(void);
+char **cmd_env(struct cmd_t *cmd);
+char *cmd_path(struct cmd_t *cmd);
+
+int hist_open(const char *file);
+void hist_close(void);
+void hist_add(const char *line, size_t len);
+long hist_sync(void);
+void hist_index(size_t off, size_t len);
+const char *hist_entry(long e, size_t *len);
+long hist_entryat(size_t off);
+long hist_find(const char *prefix, size_t len);
+char *hist_expand(char *line, size_t *len);
+
+unsigned hashname(const char *name);
+void path_validate(void);
+int path_events(void);
+void path_flush(void);
+char *path_lookup(const char *name, int hit);
+char *path_search(const char *name, const char *path);
+int path_complete(const char *prefix, size_t len, const char ***names);
+void dirlist_read(const char *dir, struct dirlist_t *dl);
+void dirlist_free(struct dirlist_t *dl);
+char *dirlist_find(const struct dirlist_t *dl, const char *name);
+int dirlist_lower(const struct dirlist_t *dl, const char *prefix, size_t len);
+int cmpstr(const void *a, const void *b);
+
+struct outbuf_t *out_attach(int jid, pid_t pgid, int fd);
+struct outbuf_t *out_find(int jid);
+void out_ready(struct evsrc_t *src);
+int out_spill(struct outbuf_t *o);
+void out_show(struct outbuf_t *o, size_t from);
+void out_free(struct outbuf_t *o);
+
+struct tok_t *glob_word(struct tok_t *t);
+void glob_walk(char *path, size_t len, const char *pat, struct globv_t *gv);
+void glob_add(struct globv_t *gv, const char *path, size_t len);
+int glob_match(const char *pat, const char *pend, const char *name);
+const struct dirlist_t *glob_dir(const char *dir);
+void glob_flush(void);
 
 void usage(void);
 void unix_error(char *msg);
@@ -104,43 +729,87 @@ handler_t *Signal(int signum, handler_t *handler);
 int main(int argc, char **argv) 
 {
     char c;
-    char cmdline[MAXLINE];
+    char *cmdline, *histfile;
+    size_t len;
     int emit_prompt = 1; /* emit prompt (default) */
 
     /* Redirect stderr to stdout (so that driver will get all output
      * on the pipe connected to stdout) */
     dup2(1, 2);
+    var_init();
+    shname = argv[0];
 
     /* Parse the command line */
-    while ((c = getopt(argc, argv, "hvp")) != EOF) {
+    while ((c = getopt(argc, argv, "hvpsob:")) != EOF) {
         switch (c) {
         case 'h':             /* print help message */
             usage();
 	    break;
         case 'v':             /* emit additional diagnostic info */
             verbose = 1;
+            trace.on = 1;     /* and record lifecycle events */
 	    break;
         case 'p':             /* don't print a prompt */
             emit_prompt = 0;  /* handy for automatic testing */
 	    break;
+        case 's':             /* launch with posix_spawn instead of fork */
+            use_spawn = 1;
+	    break;
+        case 'o':             /* capture background jobs' output */
+            capture = 1;
+	    break;
+        case 'b':             /* pipe buffer size for pipelines */
+            pipesize = atoi(optarg);
+	    break;
 	default:
             usage();
 	}
     }
+    if (optind < argc - 1)
+        usage();
 
-    /* Install the signal handlers */
-
-    /* These are the ones you will need to implement */
-    Signal(SIGINT,  sigint_handler);   /* ctrl-c */
-    Signal(SIGTSTP, sigtstp_handler);  /* ctrl-z */
-    Signal(SIGCHLD, sigchld_handler);  /* Terminated or stopped child */
-    Signal(SIGALRM, sigalrm_handler);  /* Alarm indicates killing all children */
+    /* The job signals stay blocked and are read from a signalfd by
+     * the event loop, which calls their handlers:
+     *     SIGINT  -> sigint_handler   (ctrl-c)
+     *     SIGTSTP -> sigtstp_handler  (ctrl-z)
+     *     SIGCHLD -> sigchld_handler  (terminated or stopped child) */
+    sigemptyset(&jobsigs);
+    sigaddset(&jobsigs, SIGCHLD);
+    sigaddset(&jobsigs, SIGINT);
+    sigaddset(&jobsigs, SIGTSTP);
+    /* an ignored signal would never reach the signalfd, and we may
+     * have been started with SIGINT ignored (e.g. by "sh -c 'tsh &'") */
+    Signal(SIGINT, SIG_DFL);
+    Signal(SIGTSTP, SIG_DFL);
+    Signal(SIGCHLD, SIG_DFL);
+    sigprocmask(SIG_BLOCK, &jobsigs, &shellmask);
+    ev_init();
+    wheel_init();
 
     /* This one provides a clean way to kill the shell */
     Signal(SIGQUIT, sigquit_handler); 
 
     /* Initialize the job list */
     initjobs(jobs);
+    bltn_init();
+    input_init(&input, STDIN_FILENO);
+    edit.prompt = emit_prompt ? prompt : "";
+
+    /* Keep a history in $TSH_HISTFILE, or ~/.tsh_history when interactive */
+    if ((histfile = var_get("TSH_HISTFILE")) != NULL) {
+        hist_open(histfile);
+    } else if (input.tty && (histfile = var_get("HOME")) != NULL) {
+        snprintf(sbuf, sizeof(sbuf), "%s/.tsh_history", histfile);
+        hist_open(sbuf);
+    }
+
+    /* A script named on the command line runs instead of stdin */
+    if (optind < argc) {
+        shname = argv[optind];
+        run_script(argv[optind]);
+        report_fgstats();
+        exit(0);
+    }
 
     /* Execute the shell's read/eval loop */
     while (1) {
@@ -150,16 +819,20 @@ int main(int argc, char **argv)
 	    printf("%s", prompt);
 	    fflush(stdout);
 	}
-	if ((fgets(cmdline, MAXLINE, stdin) == NULL) && ferror(stdin))
-	    app_error("fgets error");
-	if (feof(stdin)) { /* End of file (ctrl-d) */
+	if ((cmdline = input_line(&input, &len)) == NULL) { /* End of file (ctrl-d) */
+	    report_fgstats();
 	    fflush(stdout);
 	    exit(0);
 	}
 
+	/* !! and !prefix come from the history, which gets every line */
+	if (cmdline[0] == '!' && hist.fd >= 0 &&
+	    (cmdline = hist_expand(cmdline, &len)) == NULL)
+	    continue;
+	hist_add(cmdline, len);
+
 	/* Evaluate the command line */
-	eval(cmdline);
-	fflush(stdout);
+	eval(cmdline, len);
 	fflush(stdout);
     } 
 
@@ -176,570 +849,5891 @@ int main(int argc, char **argv)
  * each child process must have a unique process group ID so that our
  * background children don't receive SIGINT (SIGTSTP) from the kernel
  * when we type ctrl-c (ctrl-z) at the keyboard.  
+ *
+ * A pipeline (cmd1 | cmd2 | ...) is run as one job: every stage is
+ * its own child, but they all share the first stage's process group.
 */
-void eval(char *cmdline) 
+void eval(char *cmdline, size_t len) 
+{
+    static const struct jobopts_t none;
+
+    eval_job(cmdline, len, &none);
+}
+
+/*
+ * eval_job - Evaluate a command line, starting any job it runs as
+ *    opts says. The line may hold several commands separated by ';'
+ *    or '&'. JF_PARALLEL jobs always run in the background and
+ *    aren't announced. Returns the ID of the last job started, or 0
+ *    if the line didn't start a job. len is the line's length, which
+ *    has no limit.
+ */
+int eval_job(char *cmdline, size_t len, const struct jobopts_t *opts)
 {
 	//first things first let's parse the command line into its component parts
 	//this will break it down into the path to the command we want to execute 
 	//and the rest is command line arguments that give the command the info it needs
 	//in order to execute.
-	//paresLine does this already but we need to declare the argv array that gets
-	//passed to parseline
-	//the array is made up of pointers to characters
-	//these pointers will be populated by parseline
-	//so let's create the array
-    char bfer[MAXLINE];
-    char *argv[MAXARGS];
-    strcpy(bfer, cmdline);
-    int backg = parseline(cmdline, argv);
-    //call the parseLine function to then break uppp the input and figure out what needs to be done
-    pid_t pidVal;
-    //The job_t struct was created in order to utilize the job pointer as a bit of a "dynamic incrementer"
-	//the job pointer is primarily useful in eval in the final else statement to print out the jid and the pid's of the process.
-	//This will essentially just make it easier and I beleive a bit more efficent in the accessing information process
-    struct job_t *job;
-    //in case of NULL input
-    if(argv[0] == NULL){
-        return;
-    }
-    //now that we know it is not a built in command 
-		//we should handle the forking and execing a child process
-		//forking the child process and this if below
-		//tells us if we are in the child process
-    if(!is_builtin_cmd(argv)){
-        if((pidVal = fork()) == 0){
-            setpgid(0,0);
-            if(execvp(argv[0],argv) <0){
-                printf("%s: Command not found\n", argv[0]);
-                //if we don't try to check if the command is legal
-				//and the exec fails, it will simply go past the code and it will begin reading the command
-				//and forking and execing like a recursive shell
-				//this means each time you type in a unknown command the tsh will run
-				//and multiple tsh's will be created with no way to quit
-				//this code is to break it out of that loop if the command is not found
-            }
-            do_exit();
+	//tokenize does this in one pass, putting the words and the
+	//operators between them in the token arena. everything this
+	//line allocates there is given back at the end, so builtins that
+	//evaluate lines of their own (parallel) nest fine
+    struct tokmark_t mark = tokmark();
+    struct tok_t *toks, *end;
+    long t0 = trace.on ? mono_ns() : 0;
+    int jid = 0, ntoks;
+    size_t off = 0;
+
+    //each ';' or '&' ends a command. tokenize stops after one so that
+    //$? and variables set by the commands before it expand to what
+    //they are by the time it runs; in case of NULL input there are none
+    while(off < len){
+        ntoks = tokenize(cmdline + off, len - off, &toks);
+        if(t0 != 0){
+            trace_event(TE_PARSE, 0, 0, mono_ns() - t0);
         }
-        //here we will write a function for the parent to 
-		//wait for the child process and reap it at the same time which 
-		//we can do by using the waitfg(pid) function call
-        if(backg ==0){
-            addjob(jobs,pidVal,FG,cmdline);
-            waitfg(pidVal);
-            //this foreground specific wait function will allow the child to fully run and be reaped 
-			//otherwise this is how we get multiple tsh's running shown in the simple /bin/ps command
+        if(ntoks <= 0){
+            break;
         }
-        else{
-            addjob(jobs,pidVal,BG,cmdline);
-            int jid = get_jid_from_pid(pidVal);
-            job = getjobid(jobs,jid);
-            printf("[%d] (%d) %s", job->jid, job->pid, cmdline);
+        for(end = toks; end != NULL && end->type != T_SEMI && end->type != T_AMP; end = end->next)
+            ;
+        if(end == toks){
+            printf("syntax error near unexpected token '%s'\n", toks->s);
+            break;
         }
+        jid = eval_seg(cmdline + off, len - off, toks, end, opts);
+        if(end == NULL){
+            break;
+        }
+        off += end->end;
+        tokrelease(mark);
+        t0 = trace.on ? mono_ns() : 0;
     }
-    return;
+    tokrelease(mark);
+    return jid;
 }
 
-/* 
- * parseline - Parse the command line and build the argv array.
- * 
- * Characters enclosed in single quotes are treated as a single
- * argument.  Return true if the user has requested a BG job, false if
- * the user has requested a FG job.  
+/*
+ * eval_seg - Evaluate the command made of the tokens from first up to
+ *    end, the ';' or '&' that ends it (NULL at the end of the line).
+ *    Returns the ID of the job started, or 0.
  */
-int parseline(const char *cmdline, char **argv) 
+int eval_seg(char *line, size_t len, struct tok_t *first, struct tok_t *end,
+	     const struct jobopts_t *opts)
 {
-    static char array[MAXLINE]; /* holds local copy of command line */
-    char *buf = array;          /* ptr that traverses command line */
-    char *delim;                /* points to first space delimiter */
-    int argc;                   /* number of args */
-    int bg;                     /* background job? */
-
-    strcpy(buf, cmdline);
-    buf[strlen(buf)-1] = ' ';  /* replace trailing '\n' with space */
-    while (*buf && (*buf == ' ')) /* ignore leading spaces */
-	buf++;
+    struct pipeline_t pl;
+    char **argv, *cmdline;
+    size_t from, to;
+    char *eq;
+    long t0;
+    int type, i;
+    int backg = (end != NULL && end->type == T_AMP);
 
-    /* Build the argv list */
-    argc = 0;
-    if (*buf == '\'') {
-	buf++;
-	delim = strchr(buf, '\'');
+    //time and timeout run whatever follows them
+    if(first->type == T_WORD && !(first->flags & TF_QUOTED)){
+        if(strcmp("time", first->s) == 0 && first->next != end){
+            return do_time(line, len, first, end, opts);
+        }
+        if(strcmp("timeout", first->s) == 0){
+            return do_timeout(line, len, first, end, opts);
+        }
+        //so do pin and sched, with the job's CPUs and priority
+        if(strcmp("pin", first->s) == 0){
+            return do_pin(line, len, first, end, opts);
+        }
+        if(strcmp("sched", first->s) == 0){
+            return do_sched(line, len, first, end, opts);
+        }
     }
-    else {
-	delim = strchr(buf, ' ');
+    if(opts->flags & JF_PARALLEL){
+        backg = 1;
     }
-
-    while (delim) {
-	argv[argc++] = buf;
-	*delim = '\0';
-	buf = delim + 1;
-	while (*buf && (*buf == ' ')) /* ignore spaces */
-	       buf++;
-
-	if (*buf == '\'') {
-	    buf++;
-	    delim = strchr(buf, '\'');
-	}
-	else {
-	    delim = strchr(buf, ' ');
-	}
+    //split the tokens at each '|' into the stages of a pipeline
+    if(parsepipeline(first, end, &pl) < 0){
+        return 0;
     }
-    argv[argc] = NULL;
-    
-    if (argc == 0)  /* ignore blank line */
-	return 1;
-
-    /* should the job run in the background? */
-    if ((bg = (*argv[argc-1] == '&')) != 0) {
-	argv[--argc] = NULL;
+    argv = pl.cmds[0].argv;
+    //a line of NAME=value words just sets shell variables
+    if(argv[0] == NULL){
+        laststatus = 0;
+        for(i = 0; i < pl.cmds[0].nassigns; i++){
+            eq = strchr(pl.cmds[0].assigns[i], '=');
+            var_set(pl.cmds[0].assigns[i], eq - pl.cmds[0].assigns[i], eq + 1, 0);
+        }
+        return 0;
+    }
+    //builtins only make sense run by the shell itself, not as a pipeline stage.
+    //their redirections are applied to the shell's own descriptors for
+    //the duration of the builtin
+    t0 = trace.on ? mono_ns() : 0;
+    type = pl.ncmds == 1 ? builtin_lookup(argv[0], backg) : BLTN_UNK;
+    if(type != BLTN_UNK && pl.nredirs == 0){
+        is_builtin_cmd(argv, type);
+        if(t0 != 0 && trace.on){
+            trace_event(TE_BUILTIN, 0, 0, mono_ns() - t0);
+        }
+        return 0;
+    }
+    if(type != BLTN_UNK){
+        int saved[MAXREDIRS];
+        if(prepare_redirs(&pl.cmds[0]) == 0){
+            save_redirs(&pl.cmds[0], saved);
+            if(apply_redirs(&pl.cmds[0]) == 0){
+                is_builtin_cmd(argv, type);
+            }
+            restore_redirs(&pl.cmds[0], saved);
+        }
+        release_redirs(&pl.cmds[0]);
+        if(t0 != 0 && trace.on){
+            trace_event(TE_BUILTIN, 0, 0, mono_ns() - t0);
+        }
+        return 0;
+    }
+    //the job remembers its own part of the line, '&' included, as a
+    //line of its own. a line holding one command is kept as it is
+    from = first->start;
+    to = end == NULL || end->end + strspn(line + end->end, " \t\n") >= len ? len :
+        end->type == T_AMP ? end->end : end->start;
+    if(from == 0 && to == len){
+        cmdline = line;
+    }
+    else{
+        while(to > from && isspace(line[to - 1])){
+            to--;
+        }
+        cmdline = tokalloc(to - from + 2);
+        memcpy(cmdline, line + from, to - from);
+        cmdline[to - from] = '\n';
+        cmdline[to - from + 1] = '\0';
     }
-    return bg;
+    //now that we know it is not a built in command 
+		//we should handle the forking and execing a child process
+    return launch_job(&pl, backg, cmdline, opts);
 }
 
+/*
+ * Command lines are split into tokens in a single pass. Each byte is
+ * classified with one table lookup, and plain word characters are
+ * copied as they are scanned; single-quoted text is found with memchr.
+ * (strcspn was tried for the plain runs, but its per-call setup costs
+ * more than it saves on words as short as a shell's.) Words are
+ * unquoted into the token arena, a list of chunks that is reset to a
+ * mark when the command is done instead of being freed, so parsing
+ * allocates nothing once the first chunk exists. Room for the worst
+ * case is reserved once per line, so tokens are carved out of it with
+ * a pointer bump and what was used is claimed at the end.
+ *
+ * Two rules keep the existing traces (and their "/bin/echo tsh> ..."
+ * lines) working: < and > only start a redirection at the beginning
+ * of a word, and a backslash only escapes a character the shell would
+ * otherwise treat specially, so "\046" still reaches echo -e intact.
+ *
+ * $NAME, ${NAME}, $? and $$ are expanded as they are copied, outside
+ * quotes and inside double ones. The value stays one word (there is
+ * no field splitting), and an unquoted expansion to nothing leaves no
+ * word behind. A value longer than what it replaces can outgrow the
+ * reservation; tokroom then moves the word to a bigger one.
+ */
+
+/* Byte classes for the tokenizer */
+#define C_WORD  0   /* an ordinary word character */
+#define C_SPACE 1   /* blank or newline */
+#define C_OP    2   /* & | ; */
+#define C_SQ    3   /* ' */
+#define C_DQ    4   /* " */
+#define C_BS    5   /* \ */
+#define C_REDIR 6   /* < > */
+#define C_GLOB  7   /* * ? [ */
+#define C_END   8   /* the terminating NUL */
+#define C_DOLLAR 9  /* $ */
+
+/* Arena space one token can take besides its text, padding included */
+#define TOKSIZE (sizeof(struct tok_t) + 8)
+
+static const unsigned char tokclass[256] = {
+    ['\0'] = C_END, [' '] = C_SPACE, ['\t'] = C_SPACE, ['\r'] = C_SPACE,
+    ['\n'] = C_SPACE, ['&'] = C_OP, ['|'] = C_OP, [';'] = C_OP,
+    ['\''] = C_SQ, ['"'] = C_DQ, ['\\'] = C_BS, ['<'] = C_REDIR,
+    ['>'] = C_REDIR, ['*'] = C_GLOB, ['?'] = C_GLOB, ['['] = C_GLOB,
+    ['$'] = C_DOLLAR,
+};
 
 /*
- * is_builtin_cmd - If the user has typed a built-in command then
- * return the type of built in command, otherwise indicate that it
- * isn't a built in command
+ * tokvar - If p, just past a '$', names a variable ($NAME, ${NAME},
+ *    $? or $$) or a positional parameter ($0 to $9, ${N}), set *next
+ *    past it and return its value ("" if it is unset); num is scratch
+ *    space for the numbers. tsh passes no arguments to a script, so
+ *    $0 is shname and the other positional parameters are always
+ *    empty. Returns NULL with *next = p if the $ is just a $, or NULL
+ *    with *next = NULL for a ${ that isn't a name or number and a }.
  */
-int is_builtin_cmd(char **argv)
+static const char *tokvar(const char *p, const char **next, char *num)
 {
-	//originally I was concerned that this builtin cmnd function was order sensitive during the test03 process
-	//however it is not at all and they may be in any order desired
-	 //exit
-    if(strcmp("exit", argv[0]) == 0)
-    {
-        do_exit();
-        return 0;
-    }
-    //kill all
-    if(strcmp("killall", argv[0]) == 0)
-    {
-        do_killall(argv);
-        return 1;
-    }
-    //jobs
-    if(strcmp("jobs", argv[0]) == 0)
-    {
-        do_show_jobs();
-        return 1;
+    const char *name = *p == '{' ? p + 1 : p, *q;
+    struct var_t *v;
+
+    *next = p;
+    if (*p == '?' || *p == '$') {
+	sprintf(num, "%d", *p == '?' ? laststatus : (int)getpid());
+	*next = p + 1;
+	return num;
     }
-    //background
-    if(strcmp("bg", argv[0]) == 0)
-    {
-        do_bgfg(argv);
-        return 1;
+    if (isdigit((unsigned char)*name)) {
+	/* without braces only one digit counts: $10 is $1 then a 0 */
+	for (q = name + 1; *p == '{' && isdigit((unsigned char)*q); q++)
+	    ;
+    } else if (isalpha((unsigned char)*name) || *name == '_') {
+	for (q = name + 1; isalnum((unsigned char)*q) || *q == '_'; q++)
+	    ;
+    } else {
+	if (*p == '{')
+	    *next = NULL;
+	return NULL;
     }
-    //foreground
-    if(strcmp("fg", argv[0]) == 0)
-    {
-        do_bgfg(argv);
-        return 1;
+    if (*p == '{') {
+	if (*q != '}') {
+	    *next = NULL;
+	    return NULL;
+	}
+	*next = q + 1;
+    } else {
+	*next = q;
     }
-    return BLTN_UNK;     /* not a builtin command */
+    if (isdigit((unsigned char)*name))
+	return q - name == 1 && *name == '0' ? shname : "";
+    v = var_find(name, q - name);
+    return v != NULL ? v->str + v->namelen + 1 : "";
 }
 
 /*
- * do_exit - Execute the builtin exit command
+ * tokroom - Check that the word being copied to d, which starts at *w,
+ *    can take more bytes and still leave the worst case for the rest
+ *    bytes of line after them. If the reservation ending at *resend
+ *    is too small, everything before the word is claimed and the word
+ *    moves to a new, big enough one. Returns where d is now.
  */
-void do_exit(void)
+static char *tokroom(char **base, char **resend, char **w, char *d,
+		     size_t more, size_t rest)
 {
-// this initial case is vital to set first as it allows you to quit later on
-	//when doing development testing
-  exit(0);
+    size_t have = d - *w, need = have + more + rest * (TOKSIZE + 1) + 1;
+    char *nb;
+
+    if (d + more + rest * (TOKSIZE + 1) + 1 <= *resend)
+	return d;
+    tokalloc(*w - *base);
+    nb = tokreserve(need);
+    memmove(nb, *w, have);
+    *base = *w = nb;
+    *resend = nb + need;
+    return nb + have;
 }
 
 /*
- * do_show_jobs - Execute the builtin jobs command
+ * tokenize - Split the len bytes of line (which must be followed by
+ *    a NUL) into a list of tokens in the token arena, up to and
+ *    including the first ';' or '&', so that the variables in each
+ *    command are expanded only once the ones before it have run.
+ *    Returns the number of tokens, or -1 after reporting a syntax
+ *    error.
  */
-void do_show_jobs(void)
+int tokenize(char *line, size_t len, struct tok_t **toks)
 {
-	//this simply "cheats" off the pre-existing showjobs function
-	//written for this lab
-	//I originally had intended to utilize a for Loop for this until I read instructions
-	//as well as actually really looked at this code
-    showjobs(jobs);
+    const char *p = line, *lim = line + len, *q, *val;
+    struct tok_t *tok, **tail = toks, **prev;
+    char *base, *resend, *d, *w, num[16];
+    size_t run;
+    int c, n = 0;
+
+    /* every byte could start a token, and a word is never longer
+       than the text it came from, expansions aside */
+    d = base = tokreserve(len * (TOKSIZE + 1) + 1);
+    resend = base + len * (TOKSIZE + 1) + 1;
+    *toks = NULL;
+    for (;;) {
+	while (tokclass[(unsigned char)*p] == C_SPACE)
+	    p++;
+	if (p >= lim || *p == '\0') {          /* a NUL ends the line early */
+	    tokalloc(d - base);
+	    return n;
+	}
+	tok = (struct tok_t *)(base + ((d - base + 7) & ~(size_t)7));
+	d = (char *)(tok + 1);
+	tok->start = p - line;
+	tok->flags = 0;
+	tok->next = NULL;
+	prev = tail;
+	*tail = tok;
+	tail = &tok->next;
+	n++;
+
+	c = tokclass[(unsigned char)*p];
+	if (c == C_OP) {
+	    tok->type = *p == '|' ? T_PIPE : *p == '&' ? T_AMP : T_SEMI;
+	    tok->s = *p == '|' ? "|" : *p == '&' ? "&" : ";";
+	    tok->end = ++p - line;
+	    if (tok->type != T_PIPE) {
+		tokalloc(d - base);
+		return n;
+	    }
+	    continue;
+	}
+	if ((c == C_REDIR || (*p >= '0' && *p <= '9')) &&
+	    (run = redirscan(p, lim)) > 0) {
+	    tok->type = T_REDIR;
+	    tok->s = memcpy(d, p, run);
+	    d += run;
+	    *d++ = '\0';
+	    tok->end = (p += run) - line;
+	    continue;
+	}
+
+	/* a word, unquoted as it is copied */
+	tok->type = T_WORD;
+	for (q = p; isalnum((unsigned char)*q) || *q == '_'; q++)
+	    ;
+	if (*q == '=' && q > p && !isdigit((unsigned char)*p))
+	    tok->flags |= TF_ASSIGN;
+	w = d;
+	for (;;) {
+	    for (q = p; (c = tokclass[(unsigned char)*q]) == C_WORD; q++)
+		;
+	    memcpy(d, p, q - p);
+	    d += q - p;
+	    p = q;
+	    if (c == C_SPACE || c == C_OP || c == C_END)
+		break;                          /* end of the word */
+	    if (c == C_SQ) {
+		if ((q = memchr(p + 1, '\'', lim - p - 1)) == NULL)
+		    goto unterminated;
+		for (p++; p < q; p++) {
+		    if (tokclass[(unsigned char)*p] == C_GLOB)
+			tok->flags |= TF_QGLOB;
+		    *d++ = *p;
+		}
+		p = q + 1;
+		tok->flags |= TF_QUOTED;
+	    } else if (c == C_DQ) {
+		for (p++; *p != '"'; ) {
+		    if (*p == '\0')
+			goto unterminated;
+		    if (*p == '$' && ((val = tokvar(p + 1, &q, num)) != NULL ||
+				      q == NULL)) {
+			if (q == NULL)
+			    goto badsubst;
+			run = strlen(val);
+			d = tokroom(&base, &resend, &w, d, run, lim - q);
+			memcpy(d, val, run);
+			d += run;
+			p = q;
+			continue;
+		    }
+		    /* inside double quotes \ only escapes " \ $ and ` */
+		    if (*p == '\\' && p[1] != '\0' && strchr("\"\\$`", p[1]))
+			p++;
+		    if (tokclass[(unsigned char)*p] == C_GLOB)
+			tok->flags |= TF_QGLOB;
+		    *d++ = *p++;
+		}
+		p++;
+		tok->flags |= TF_QUOTED;
+	    } else if (c == C_BS) {
+		if (p[1] == '\n') {
+		    p += 2;                     /* line continuation */
+		} else if (p[1] != '\0' && tokclass[(unsigned char)p[1]] != C_WORD) {
+		    if (tokclass[(unsigned char)p[1]] == C_GLOB)
+			tok->flags |= TF_QGLOB;
+		    *d++ = p[1];
+		    p += 2;
+		    tok->flags |= TF_QUOTED;
+		} else {
+		    *d++ = *p++;
+		}
+	    } else if (c == C_DOLLAR && ((val = tokvar(p + 1, &q, num)) != NULL ||
+					 q == NULL)) {
+		if (q == NULL)
+		    goto badsubst;
+		run = strlen(val);
+		d = tokroom(&base, &resend, &w, d, run, lim - q);
+		memcpy(d, val, run);
+		d += run;
+		p = q;
+		tok->flags |= TF_EXPANDED;
+	    } else {
+		if (c == C_GLOB)
+		    tok->flags |= TF_GLOB;
+		*d++ = *p++;                    /* < > or $ inside a word */
+	    }
+	}
+	if (d == w && (tok->flags & (TF_EXPANDED | TF_QUOTED)) == TF_EXPANDED) {
+	    *prev = NULL;                       /* it expanded to nothing */
+	    tail = prev;
+	    n--;
+	    continue;
+	}
+	*d++ = '\0';
+	tok->s = w;
+	tok->end = p - line;
+    }
+
+ unterminated:
+    printf("syntax error: unterminated quote\n");
+    return -1;
+ badsubst:
+    printf("syntax error: bad substitution\n");
+    return -1;
 }
 
 /*
- * do_ignore_singleton - Display the message to ignore a singleton '&'
+ * redirscan - Return the length of the redirection operator at p, with
+ *    its descriptor numbers ([n]<, [n]>, [n]>>, [n]>&m, [n]<<<), or 0
+ *    if p doesn't start one
  */
-void do_ignore_singleton(void)
-{   
-	//this is important to making sure the shell doesn't freak out with singleton &'s
-    if(prompt[0] ==  '&'){
-    	//app_error was again another provided function vital in making my life easier
-        app_error("ignoring singleton '&'!");
+int redirscan(const char *p, const char *lim)
+{
+    const char *q = p;
+
+    while (q < lim && isdigit(*q))
+	q++;
+    if (q >= lim || (*q != '<' && *q != '>'))
+	return 0;
+    if (*q == '<') {
+	q += (lim - q >= 3 && q[1] == '<' && q[2] == '<') ? 3 : 1;
+    } else if (++q < lim && *q == '>') {
+	q++;
+    } else if (q < lim && *q == '&') {
+	for (q++; q < lim && isdigit(*q); q++)
+	    ;
     }
-  return;
+    return q - p;
 }
 
-void do_killall(char **argv)
+/* tokmark - Remember how much of the token arena is in use */
+struct tokmark_t tokmark(void)
 {
-	//kill all utilizes a timeout killall approach
-	//i.e. the resoning for the timeout alarm value
-    int timeoutAlm = atoi(argv[1]);
-    alarm(timeoutAlm);
-    return;
+    struct tokmark_t m;
+
+    if (tokcur == NULL)
+	tokreserve(0);                  /* the first chunk */
+    m.chunk = tokcur;
+    m.used = tokcur->used;
+    return m;
 }
 
-/* 
- * do_bgfg - Execute the builtin bg and fg commands
+/* tokrelease - Give back everything allocated since mark was taken */
+void tokrelease(struct tokmark_t mark)
+{
+    tokcur = mark.chunk;
+    tokcur->used = mark.used;
+}
+
+/*
+ * tokreserve - Return at least size contiguous bytes of the token
+ *    arena without handing them out; tokalloc claims what was used
  */
-void do_bgfg(char **argv) 
+char *tokreserve(size_t size)
 {
-    if((argv[1]) == NULL){
-        //Edge case
-        printf("%s command requires PID or Jjobid argument\n", argv[0]);
-        return;
+    struct tokchunk_t *c, *next;
+
+    size = (size + 7) & ~(size_t)7;
+    if (tokcur != NULL && tokcur->size - tokcur->used >= size)
+	return tokcur->data + tokcur->used;
+    /* move on to the next chunk, or put a big enough one in its place */
+    next = tokcur ? tokcur->next : NULL;
+    if (next == NULL || next->size < size) {
+	if ((c = malloc(sizeof(*c) + (size > TOKCHUNK ? size : TOKCHUNK))) == NULL)
+	    unix_error("malloc error");
+	c->size = size > TOKCHUNK ? size : TOKCHUNK;
+	c->next = next;
+	if (tokcur != NULL)
+	    tokcur->next = c;
+	next = c;
     }
-    int piDTrue = 1;
-     //initialize the integer which will behave as a switch for JID or PID
-    //the if statement below will determine if the input is a PID
-    //if it is, it will set piDInput to 1
-    if(isdigit(argv[1][0])!=0){
-        piDTrue=1;
+    next->used = 0;
+    tokcur = next;
+    return tokcur->data;
+}
+
+/* tokalloc - Allocate size bytes from the token arena */
+void *tokalloc(size_t size)
+{
+    char *p = tokreserve(size);
+
+    tokcur->used += (size + 7) & ~(size_t)7;
+    return p;
+}
+
+/*
+ * parsepipeline - Build a pipeline from the tokens from first up to
+ *    end: each '|' starts a new command, and each redirection
+ *    operator takes the word after it (or the digits glued to a >&)
+ *    as its target. Patterns are expanded into the words they match
+ *    first. The argv arrays go in the token arena. Returns the number
+ *    of commands, or -1 after reporting a syntax error.
+ */
+int parsepipeline(struct tok_t *first, struct tok_t *end,
+		  struct pipeline_t *pl)
+{
+    struct tok_t *t, *u;
+    struct cmd_t *cmd;
+    struct redir_t *r, target;
+    int n, len;
+
+    pl->ncmds = 0;
+    pl->nredirs = 0;
+    for (t = first; ; t = t->next) {
+	if (pl->ncmds == MAXCMDS) {
+	    printf("too many commands in pipeline\n");
+	    return -1;
+	}
+	cmd = &pl->cmds[pl->ncmds++];
+	cmd->redirs = &pl->redirs[pl->nredirs];
+	cmd->nredirs = 0;
+	for (u = t; u != end && u->type != T_PIPE; u = u->next) {
+	    /* a pattern becomes the words it matches, except as a
+	       redirection target or with quoted pattern bytes in it */
+	    if (u->type == T_REDIR && u->s[redirop(u->s, &target)] == '\0' &&
+		u->next != end && u->next->type == T_WORD) {
+		u = u->next;
+		continue;
+	    }
+	    if (u->type == T_WORD && (u->flags & (TF_GLOB | TF_QGLOB)) == TF_GLOB)
+		u = glob_word(u);
+	}
+	for (n = 0, u = t; u != end && u->type != T_PIPE; u = u->next)
+	    n += u->type == T_WORD;
+	/* NAME=value words before the command go in its environment */
+	cmd->assigns = tokalloc((n + 1) * sizeof(char *));
+	cmd->nassigns = 0;
+	cmd->argv = cmd->assigns;
+	for (n = 0; t != end && t->type != T_PIPE; t = t->next) {
+	    if (t->type == T_WORD && n == 0 && (t->flags & TF_ASSIGN)) {
+		cmd->assigns[cmd->nassigns++] = t->s;
+		cmd->argv++;
+		continue;
+	    }
+	    if (t->type == T_WORD) {
+		cmd->argv[n++] = t->s;
+		continue;
+	    }
+	    if (pl->nredirs == MAXREDIRS) {
+		printf("too many redirections\n");
+		return -1;
+	    }
+	    r = &pl->redirs[pl->nredirs];
+	    len = redirop(t->s, r);
+	    if (t->s[len] != '\0')
+		r->target = &t->s[len];
+	    else if (t->next == end || t->next->type != T_WORD) {
+		printf("syntax error near unexpected token '%s'\n",
+		       t->next == end ? "newline" : t->next->s);
+		return -1;
+	    } else {
+		t = t->next;
+		r->target = t->s;
+	    }
+	    if (r->op == R_DUP && !isdigit(r->target[0])) {
+		printf("%s: bad file descriptor\n", r->target);
+		return -1;
+	    }
+	    r->herefd = -1;
+	    pl->nredirs++;
+	    cmd->nredirs++;
+	}
+	cmd->argv[n] = NULL;
+	if (n == 0 && cmd->nassigns > 0 && pl->ncmds == 1 && t == end &&
+	    cmd->nredirs == 0)
+	    return 1;                   /* just assignments */
+	if (n == 0) {
+	    if (cmd->nredirs > 0)
+		printf("syntax error: redirection without a command\n");
+	    else
+		printf("syntax error near unexpected token '|'\n");
+	    return -1;
+	}
+	if (t == end)
+	    return pl->ncmds;
     }
-    else if((argv[1][0]) == 'J'){
-        piDTrue = 0;      
+}
+
+/*
+ * launch_job - Start every command of a pipeline, connecting each
+ *    one's stdout to the next one's stdin, and record them as a
+ *    single job with the given options. A foreground job is waited
+ *    for before returning. Returns the job ID, or 0 if nothing could
+ *    be started.
+ */
+int launch_job(struct pipeline_t *pl, int bg, char *cmdline,
+	       const struct jobopts_t *opts)
+{
+    pid_t pids[MAXCMDS], pgid = 0, pid;
+    int i, n = 0, jid = 0, infd = -1, outfd, fds[2], cap[2] = { -1, -1 };
+    struct job_t *job;
+    struct sched_t sc = opts->sched;
+
+    //a bare name no PATH directory holds would only fork a child to
+    //say so. the catalog knows without one, unless the command brings
+    //a PATH of its own
+    if (pl->ncmds == 1 && strchr(pl->cmds[0].argv[0], '/') == NULL &&
+        cmd_path(&pl->cmds[0]) == NULL &&
+        path_lookup(pl->cmds[0].argv[0], 0) == NULL) {
+        printf("%s: Command not found\n", pl->cmds[0].argv[0]);
+        laststatus = 127;
+        return 0;
     }
-    else{
-        printf("%s argument must be PID or Jjobid\n", argv[0]);
-        return;
+
+    //with sched spread on, each background job that wasn't pinned
+    //gets the next of the shell's CPUs to itself
+    if (bg && spread.on && !(sc.set & SC_CPUS)) {
+	CPU_ZERO(&sc.cpus);
+	CPU_SET(spread.next, &sc.cpus);
+	sc.set |= SC_CPUS;
+	do
+	    spread.next = (spread.next + 1) % CPU_SETSIZE;
+	while (!CPU_ISSET(spread.next, &spread.cpus));
     }
-    pid_t pidVal;
-    struct job_t *job;
-    int jiD;
-    //all of these intitializations are vital to the final if statement of processing either a JID or PID to do either bg or fg
-    if(piDTrue){
-        pidVal = atoi(argv[1]);
-        job = getprocessid(jobs, pidVal);
-        if(job == NULL){
-            printf("(%s): No such process\n", argv[1]);
-            return;
-        }
+
+    //with output on, a background job's stdout is a pipe the shell
+    //drains into the job's buffer instead of the terminal
+    if (bg && capture && !(opts->flags & JF_PARALLEL) &&
+        pipe2(cap, O_CLOEXEC) < 0) {
+	printf("pipe error: %s\n", strerror(errno));
+	return 0;
+    }
+
+    //children are only reaped from the event loop, so even a
+    //short-lived child is still there when addjob puts it on the list
+    fflush(stdout);             /* children must not inherit pending output */
+
+    for (i = 0; i < pl->ncmds; i++) {
+	outfd = -1;
+	fds[0] = -1;
+	if (i < pl->ncmds - 1) {
+	    if (pipe2(fds, O_CLOEXEC) < 0) {
+		printf("pipe error: %s\n", strerror(errno));
+		if (infd >= 0)
+		    close(infd);
+		break;
+	    }
+	    if (pipesize > 0)
+		fcntl(fds[1], F_SETPIPE_SZ, pipesize);
+	    outfd = fds[1];
+	} else if (cap[1] >= 0) {
+	    outfd = cap[1];             /* closed below, like a pipe end */
+	}
+	if (prepare_redirs(&pl->cmds[i]) == 0 &&
+	    (pid = launch_cmd(&pl->cmds[i], pgid, infd, outfd, &shellmask, &sc)) > 0) {
+	    if (pgid == 0)
+		pgid = pid;
+	    pids[n++] = pid;
+	}
+	release_redirs(&pl->cmds[i]);
+	/* the children hold their own copies of the pipe ends now */
+	if (infd >= 0)
+	    close(infd);
+	if (outfd >= 0)
+	    close(outfd);
+	infd = fds[0];
+    }
+
+    //here we will write a function for the parent to 
+    //wait for the child process and reap it at the same time which 
+    //we can do by using the waitfg(pid) function call
+    if (n == 0) {
+	/* nothing could be started */
+	if (cap[0] >= 0)
+	    close(cap[0]);
+    }
+    else if(!addjobprocs(jobs, pids, n, bg ? BG : FG, cmdline)){
+	//a child nobody tracks could never be waited for or signalled
+	kill(-pgid, SIGKILL);
+	if (cap[0] >= 0)
+	    close(cap[0]);
     }
-    //this else pertains to whether the argument was a PID or JID argument from the user
-    //this means in this else statement it is processing a JID argument
     else{
-        jiD = atoi(&argv[1][1]);
-        job = getjobid(jobs,jiD);
-        if(job == NULL){
-            printf("%s: No such job\n", argv[1]);
-            return;
+	job = getprocessid(jobs, pgid);
+	job->flags = opts->flags;
+	jid = job->jid;
+	if (cap[0] >= 0)
+	    out_attach(jid, pgid, cap[0]);
+	if (opts->flags & JF_PARALLEL)
+	    par.running++;
+	//the deadline has to be on the wheel before a foreground wait
+	if (opts->timeout_ms > 0 &&
+	    (job->deadline = malloc(sizeof(*job->deadline))) != NULL) {
+	    memset(job->deadline, 0, sizeof(*job->deadline));
+	    job->deadline->t.fn = job_expire;
+	    job->deadline->pgid = pgid;
+	    job->deadline->killafter_ms = opts->killafter_ms;
+	    wt_add(&job->deadline->t, opts->timeout_ms);
+	}
+	if(!bg){
+	    waitfg(pgid);
+	    //this foreground specific wait function will allow the child to fully run and be reaped 
+	    //otherwise this is how we get multiple tsh's running shown in the simple /bin/ps command
+	}
+	else if (!(opts->flags & JF_PARALLEL)){
+	    printf("[%d] (%d) %s", job->jid, job->pid, cmdline);
+	}
+    }
+    return jid;
+}
+
+/*
+ * launch_cmd - Start one command of a job in process group pgid (a
+ *    new group led by the command itself when pgid is 0). infd and
+ *    outfd, when not -1, become the command's stdin and stdout. mask
+ *    is the signal mask the command should run with, and sc the
+ *    scheduling attributes. Returns the child's PID, or -1 if the
+ *    command couldn't be started.
+ */
+pid_t launch_cmd(struct cmd_t *cmd, pid_t pgid, int infd, int outfd,
+		 const sigset_t *mask, const struct sched_t *sc)
+{
+    char **argv = cmd->argv, **env;
+    char *path = NULL, *over = NULL;
+    pid_t pid;
+    long t0;
+    int sync[2] = { -1, -1 };
+    char c;
+
+    //resolve bare command names through the hash table so the child
+    //can execve the right file instead of probing every PATH entry.
+    //a PATH=... prefix is searched directly and never goes in the table
+    if (strchr(argv[0], '/') == NULL) {
+	if ((over = cmd_path(cmd)) != NULL)
+	    path = path_search(argv[0], over);
+	else
+	    path = path_lookup(argv[0], 1);
+    }
+
+    t0 = trace.on ? mono_ns() : 0;
+    //posix_spawn can't set the affinity or memory policy, so a
+    //command with scheduling attributes is always forked
+    if (use_spawn && sc->set == 0) {
+	//posix_spawn reports a failed exec back to us, so there is
+	//no child to reap when the command doesn't exist. it returns
+	//after the exec, so the fork event covers both
+	//a job that never started has no exit status to report, so
+	//set the one its child would have exited with
+	if ((pid = spawn_job(cmd, path, pgid, infd, outfd, mask)) < 0) {
+	    laststatus = errno != 0 ? 127 : 1;
+	    if (laststatus == 127)
+		printf("%s: Command not found\n", argv[0]);
+	}
+	if (t0 != 0 && pid > 0)
+	    trace_event(TE_FORK, pid, 0, mono_ns() - t0);
+	return pid;
+    }
+
+    //the environment is built before the fork, so the child only execs
+    env = cmd_env(cmd);
+    //while tracing, a close-on-exec pipe tells us when the child execs
+    if (t0 != 0 && pipe2(sync, O_CLOEXEC) < 0)
+	sync[0] = sync[1] = -1;
+    if ((pid = fork()) == 0) {
+	sigprocmask(SIG_SETMASK, mask, NULL);
+	setpgid(0, pgid);
+	if (infd >= 0)
+	    dup2(infd, STDIN_FILENO);
+	if (outfd >= 0)
+	    dup2(outfd, STDOUT_FILENO);
+	if (apply_redirs(cmd) < 0 || sched_apply(sc) < 0) {
+	    fflush(stdout);
+	    _exit(1);
+	}
+	if (path != NULL)
+	    execve(path, argv, env);
+	//execvpe searches the shell's own PATH, not the command's
+	if (over != NULL || execvpe(argv[0], argv, env) < 0) {
+	    printf("%s: Command not found\n", argv[0]);
+	    //if we don't try to check if the command is legal
+	    //and the exec fails, it will simply go past the code and it will begin reading the command
+	    //and forking and execing like a recursive shell
+	    //this means each time you type in a unknown command the tsh will run
+	    //and multiple tsh's will be created with no way to quit
+	    //this code is to break it out of that loop if the command is not found
+	}
+	fflush(stdout);
+	_exit(127);
+    }
+    if (pid < 0) {
+	printf("fork error: %s\n", strerror(errno));
+	if (sync[0] >= 0) {
+	    close(sync[0]);
+	    close(sync[1]);
+	}
+	return -1;
+    }
+    /* set the group from this side too, so the next stage can join it
+     * even if this child hasn't been scheduled yet */
+    setpgid(pid, pgid ? pgid : pid);
+    if (t0 != 0) {
+	trace_event(TE_FORK, pid, 0, mono_ns() - t0);
+	if (sync[0] >= 0) {
+	    /* EOF once the child has exec'd (or exited) */
+	    t0 = mono_ns();
+	    close(sync[1]);
+	    while (read(sync[0], &c, 1) < 0 && errno == EINTR)
+		;
+	    close(sync[0]);
+	    trace_event(TE_EXEC, pid, 0, mono_ns() - t0);
+	}
+    }
+    return pid;
+}
+
+/*
+ * spawn_job - Launch argv in process group pgid with posix_spawn
+ *
+ * glibc implements posix_spawn with clone(CLONE_VM|CLONE_VFORK), so
+ * unlike fork() the cost doesn't grow with the shell's footprint.
+ * If path is non-NULL it is executed directly, otherwise argv[0] is
+ * searched for in PATH. infd/outfd, when not -1, are installed as
+ * stdin/stdout, followed by cmd's redirections. Redirection files are
+ * opened here rather than by spawn file actions so that an open error
+ * isn't mistaken for a missing command. The child gets the signal
+ * mask the shell started with. Returns the child's
+ * PID, or -1 with errno set if the command couldn't be executed
+ * (errno 0 if a redirection failed and was already reported).
+ */
+pid_t spawn_job(struct cmd_t *cmd, const char *path, pid_t pgid, int infd,
+		int outfd, const sigset_t *mask)
+{
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
+    char **argv = cmd->argv;
+    int i, fd, opened, toclose[MAXREDIRS], nclose = 0;
+    pid_t pid;
+    int rc = 0;
+
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP |
+                             POSIX_SPAWN_SETSIGMASK);
+    posix_spawnattr_setpgroup(&attr, pgid);   /* 0: pgid = child's pid */
+    posix_spawnattr_setsigmask(&attr, mask);
+    posix_spawn_file_actions_init(&fa);
+    if (infd >= 0)
+        posix_spawn_file_actions_adddup2(&fa, infd, STDIN_FILENO);
+    if (outfd >= 0)
+        posix_spawn_file_actions_adddup2(&fa, outfd, STDOUT_FILENO);
+    for (i = 0; i < cmd->nredirs; i++) {
+        if ((fd = open_redir(&cmd->redirs[i], &opened)) < 0) {
+            printf("%s: %s\n", cmd->redirs[i].target, strerror(errno));
+            rc = -1;
+            break;
         }
-        pidVal = job->pid;
+        if (opened)
+            toclose[nclose++] = fd;
+        posix_spawn_file_actions_adddup2(&fa, fd, cmd->redirs[i].fd);
     }
-    //using a simple strcmp we can determine if the user inputted the bg or fg command
-    //in this if statement, if it is entered, it follows that it will utilize sigcont and kill the process and report the jid, pid, cmdline and then set the job state
-    if(strcmp(argv[0], "bg") ==0){
-        kill(-pidVal, SIGCONT);
-        printf("[%d] (%d) %s", job->jid, job->pid,job->cmdline);
-        job->state = BG;
+
+    if (rc == 0 && path != NULL)
+        rc = posix_spawn(&pid, path, &fa, &attr, argv, cmd_env(cmd));
+    else if (rc == 0 && cmd_path(cmd) != NULL)
+        rc = ENOENT;    /* posix_spawnp would search the shell's PATH */
+    else if (rc == 0)
+        rc = posix_spawnp(&pid, argv[0], &fa, &attr, argv, cmd_env(cmd));
+    while (nclose > 0)
+        close(toclose[--nclose]);
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&attr);
+    if (rc != 0) {
+        errno = rc < 0 ? 0 : rc;
+        return -1;
+    }
+    return pid;
+}
+
+/*
+ * redirop - If arg starts with a redirection operator, fill in the
+ *    operator and descriptor of r and return the operator's length
+ *    (including any descriptor number), otherwise return 0
+ */
+int redirop(const char *arg, struct redir_t *r)
+{
+    const char *p = arg;
+    int fd = -1;
+
+    if (isdigit(*p)) {
+	for (fd = 0; isdigit(*p); p++)
+	    fd = fd * 10 + (*p - '0');
+	if (*p != '<' && *p != '>')
+	    return 0;                   /* just a number */
+    }
+    if (strncmp(p, "<<<", 3) == 0) {
+	r->op = R_HERESTR;
+	p += 3;
+    } else if (strncmp(p, ">>", 2) == 0) {
+	r->op = R_APPEND;
+	p += 2;
+    } else if (strncmp(p, ">&", 2) == 0) {
+	r->op = R_DUP;
+	p += 2;
+    } else if (*p == '>') {
+	r->op = R_OUT;
+	p++;
+    } else if (*p == '<') {
+	r->op = R_IN;
+	p++;
+    } else {
+	return 0;
+    }
+    r->fd = fd >= 0 ? fd : (r->op == R_IN || r->op == R_HERESTR) ? 0 : 1;
+    return p - arg;
+}
+
+/*
+ * prepare_redirs - Load each here-string of cmd into a pipe whose
+ *    read end becomes the command's input. The pipe is grown with
+ *    F_SETPIPE_SZ when the text won't fit the default buffer, so the
+ *    whole payload is normally written up front. Text too big for
+ *    even the largest pipe is handed to here_feeder instead. Returns
+ *    0, or -1 after an error.
+ */
+int prepare_redirs(struct cmd_t *cmd)
+{
+    struct redir_t *r;
+    int i, fds[2];
+    size_t len;
+
+    for (i = 0; i < cmd->nredirs; i++) {
+	r = &cmd->redirs[i];
+	if (r->op != R_HERESTR)
+	    continue;
+	len = strlen(r->target);
+	if (pipe2(fds, O_CLOEXEC) < 0) {
+	    printf("pipe error: %s\n", strerror(errno));
+	    return -1;
+	}
+	if ((long)len + 1 > fcntl(fds[1], F_GETPIPE_SZ) &&
+	    fcntl(fds[1], F_SETPIPE_SZ, len + 1) < 0) {
+	    if (here_feeder(fds, r->target, len) < 0) {
+		printf("here-string: %s\n", strerror(errno));
+		close(fds[0]);
+		close(fds[1]);
+		return -1;
+	    }
+	} else if (write(fds[1], r->target, len) < 0 || write(fds[1], "\n", 1) < 0) {
+	    /* the pipe can hold it all, so these writes never block */
+	    printf("here-string: %s\n", strerror(errno));
+	}
+	close(fds[1]);
+	r->herefd = fds[0];
+    }
+    return 0;
+}
+
+/*
+ * here_feeder - Start a process that writes the len bytes of text and
+ *    a newline into the pipe fds, for a here-string too big to load
+ *    up front. It is forked twice so that init, not the shell, reaps
+ *    it; the middle process exits at once and is waited for here. The
+ *    feeder keeps only the pipe's write end open, so it never holds
+ *    up EOF on another pipe, and a reader that quits early ends it
+ *    with SIGPIPE. Returns 0, or -1 if a fork failed.
+ */
+int here_feeder(int fds[2], const char *text, size_t len)
+{
+    pid_t pid;
+    ssize_t n;
+    int status;
+
+    if ((pid = fork()) < 0)
+	return -1;
+    if (pid == 0) {
+	if ((pid = fork()) != 0)
+	    _exit(pid < 0);
+	dup2(fds[1], STDOUT_FILENO);
+	close_range(STDERR_FILENO + 1, ~0U, 0);
+	for (; len > 0; text += n, len -= n) {
+	    if ((n = write(STDOUT_FILENO, text, len)) < 0) {
+		if (errno == EINTR) {
+		    n = 0;
+		    continue;
+		}
+		_exit(1);
+	    }
+	}
+	_exit(write(STDOUT_FILENO, "\n", 1) == 1 ? 0 : 1);
+    }
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+	;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+	errno = EAGAIN;                 /* the second fork failed */
+	return -1;
+    }
+    return 0;
+}
+
+/* release_redirs - Close the here-string pipes made by prepare_redirs */
+void release_redirs(struct cmd_t *cmd)
+{
+    int i;
+
+    for (i = 0; i < cmd->nredirs; i++) {
+	if (cmd->redirs[i].herefd >= 0) {
+	    close(cmd->redirs[i].herefd);
+	    cmd->redirs[i].herefd = -1;
+	}
+    }
+}
+
+/*
+ * open_redir - Return the descriptor that should be installed for
+ *    redirection r. Files are opened O_CLOEXEC, so only the dup2'd
+ *    copy survives into an exec'd program; *opened is set when the
+ *    caller must close the returned descriptor. Returns -1 with
+ *    errno set if a file can't be opened.
+ */
+int open_redir(struct redir_t *r, int *opened)
+{
+    *opened = 0;
+    switch (r->op) {
+    case R_DUP:
+	return atoi(r->target);
+    case R_HERESTR:
+	return r->herefd;
+    case R_IN:
+	*opened = 1;
+	return open(r->target, O_RDONLY | O_CLOEXEC);
+    case R_OUT:
+	*opened = 1;
+	return open(r->target, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    default:                    /* R_APPEND */
+	*opened = 1;
+	return open(r->target, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+    }
+}
+
+/*
+ * apply_redirs - Install cmd's redirections, in order, on the calling
+ *    process's descriptors. Returns 0, or -1 after reporting the
+ *    redirection that failed.
+ */
+int apply_redirs(struct cmd_t *cmd)
+{
+    struct redir_t *r;
+    int i, fd, opened;
+
+    for (i = 0; i < cmd->nredirs; i++) {
+	r = &cmd->redirs[i];
+	if ((fd = open_redir(r, &opened)) < 0) {
+	    printf("%s: %s\n", r->target, strerror(errno));
+	    return -1;
+	}
+	if (fd == r->fd) {
+	    /* already in place; just make sure it survives exec */
+	    fcntl(fd, F_SETFD, 0);
+	    continue;
+	}
+	if (dup2(fd, r->fd) < 0) {
+	    printf("%s: %s\n", r->target, strerror(errno));
+	    if (opened)
+		close(fd);
+	    return -1;
+	}
+	if (opened)
+	    close(fd);
+    }
+    return 0;
+}
+
+/*
+ * save_redirs - Before a builtin runs with redirections, stash a
+ *    close-on-exec copy of every descriptor they will replace in
+ *    saved[] (-1 where the descriptor wasn't open)
+ */
+void save_redirs(struct cmd_t *cmd, int *saved)
+{
+    int i;
+
+    fflush(stdout);
+    for (i = 0; i < cmd->nredirs; i++)
+	saved[i] = fcntl(cmd->redirs[i].fd, F_DUPFD_CLOEXEC, 10);
+}
+
+/* restore_redirs - Put back the descriptors stashed by save_redirs */
+void restore_redirs(struct cmd_t *cmd, int *saved)
+{
+    int i;
+
+    fflush(stdout);
+    for (i = cmd->nredirs - 1; i >= 0; i--) {
+	if (saved[i] >= 0) {
+	    dup2(saved[i], cmd->redirs[i].fd);
+	    close(saved[i]);
+	} else {
+	    close(cmd->redirs[i].fd);
+	}
+    }
+}
+
+/*
+ * is_builtin_cmd - Run the built-in command of the given type, as
+ * builtin_lookup found it for argv[0], and return the type, or
+ * BLTN_UNK if it isn't a built in command
+ */
+int is_builtin_cmd(char **argv, int type)
+{
+	//originally I was concerned that this builtin cmnd function was order sensitive during the test03 process
+	//however it is not at all and they may be in any order desired.
+	//builtin_lookup has already found the type with one hash and one
+	//strcmp, so this is just the dispatch
+    laststatus = 0;
+    switch(type)
+    {
+    //exit
+    case BLTN_EXIT:
+        do_exit();
+        return type;
+    //kill all
+    case BLTN_KILLALL:
+        do_killall(argv);
+        return type;
+    //jobs
+    case BLTN_JOBS:
+        do_show_jobs(argv);
+        return type;
+    //background and foreground
+    case BLTN_BGFG:
+        do_bgfg(argv);
+        return type;
+    //remembered command locations
+    case BLTN_HASH:
+        do_hash(argv);
+        return type;
+    //bounded-concurrency runner
+    case BLTN_PARALLEL:
+        do_parallel(argv);
+        return type;
+    //lifecycle tracing
+    case BLTN_TRACE:
+        do_trace(argv);
+        return type;
+    //the utilities scripts run all the time, without a fork and exec
+    case BLTN_ECHO:
+        do_echo(argv);
+        return type;
+    case BLTN_PRINTF:
+        do_printf(argv);
+        return type;
+    case BLTN_TRUE:
+        return type;
+    case BLTN_FALSE:
+        laststatus = 1;
+        return type;
+    case BLTN_TEST:
+        do_test(argv);
+        return type;
+    case BLTN_CD:
+        do_cd(argv);
+        return type;
+    case BLTN_PWD:
+        do_pwd(argv);
+        return type;
+    //command history
+    case BLTN_HISTORY:
+        do_history(argv);
+        return type;
+    //shell variables
+    case BLTN_EXPORT:
+        do_export(argv);
+        return type;
+    case BLTN_UNSET:
+        do_unset(argv);
+        return type;
+    //captured background output
+    case BLTN_OUTPUT:
+        do_output(argv);
+        return type;
+    }
+    return BLTN_UNK;     /* not a builtin command */
+}
+
+/*
+ * do_exit - Execute the builtin exit command
+ */
+void do_exit(void)
+{
+// this initial case is vital to set first as it allows you to quit later on
+	//when doing development testing
+  report_fgstats();
+  exit(0);
+}
+
+/*
+ * do_show_jobs - Execute the builtin jobs command
+ */
+void do_show_jobs(char **argv)
+{
+	//this simply "cheats" off the pre-existing showjobs function
+	//written for this lab
+	//I originally had intended to utilize a for Loop for this until I read instructions
+	//as well as actually really looked at this code
+    //jobs -l adds what each job has used so far
+    if(argv[1] != NULL && strcmp(argv[1], "-l") == 0)
+    {
+        showjobs_long(jobs);
+        return;
+    }
+    showjobs(jobs);
+}
+
+/*
+ * do_time - Execute the builtin time command
+ *
+ * "time cmd ..." runs the rest of the command as usual. A job started
+ * by it is flagged JF_TIMED and sigchld_handler prints its wall-clock
+ * time and resource usage when the last process is reaped, so this
+ * works for background jobs too. A builtin only gets a wall-clock time.
+ * t is the "time" token and end the one ending the command. Returns
+ * the job ID, or 0 if no job was started.
+ */
+int do_time(char *line, size_t len, struct tok_t *t, struct tok_t *end,
+	    const struct jobopts_t *opts)
+{
+    struct jobopts_t o = *opts;
+    struct timespec t0;
+    struct usage_t none;
+    int jid;
+
+    o.flags |= JF_TIMED;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if ((jid = eval_seg(line, len, t->next, end, &o)) == 0) {
+        memset(&none, 0, sizeof(none));
+        fmtusage(sbuf, sizeof(sbuf), &none, elapsed_ns(&t0));
+        printf("%s\n", sbuf);
+    }
+    return jid;
+}
+
+/*
+ * do_timeout - Execute the builtin timeout command
+ *
+ * "timeout [-k kill] secs cmd ..." runs the rest of the command with a
+ * deadline on the timer wheel: if the job is still around after secs
+ * seconds its process group gets a SIGINT, followed by a SIGKILL kill
+ * seconds later if -k was given. Fractions like 0.5 are allowed.
+ * Returns the job ID, or 0 if no job was started.
+ */
+int do_timeout(char *line, size_t len, struct tok_t *t, struct tok_t *end,
+	       const struct jobopts_t *opts)
+{
+    struct jobopts_t o = *opts;
+
+    t = t->next;
+    if (t != end && strcmp(t->s, "-k") == 0 && t->next != end) {
+        o.killafter_ms = atof(t->next->s) * 1000;
+        t = t->next->next;
+    }
+    if (t == end || t->next == end || t->type != T_WORD ||
+        (o.timeout_ms = atof(t->s) * 1000) <= 0) {
+        printf("usage: timeout [-k secs] secs command\n");
+        return 0;
+    }
+    return eval_seg(line, len, t->next, end, &o);
+}
+
+/*
+ * do_pin - Execute the builtin pin command
+ *
+ * "pin cpulist cmd ..." runs the rest of the command on just the CPUs
+ * listed, like 0-3,6. Returns the job ID, or 0 if no job was started.
+ */
+int do_pin(char *line, size_t len, struct tok_t *t, struct tok_t *end,
+	   const struct jobopts_t *opts)
+{
+    struct jobopts_t o = *opts;
+
+    t = t->next;
+    if (t == end || t->next == end || t->type != T_WORD) {
+        printf("usage: pin cpulist command\n");
+        return 0;
+    }
+    if (cpulist(t->s, &o.sched.cpus, 1) < 0) {
+        printf("pin: no usable CPU in '%s'\n", t->s);
+        return 0;
+    }
+    o.sched.set |= SC_CPUS;
+    return eval_seg(line, len, t->next, end, &o);
+}
+
+/*
+ * do_sched - Execute the builtin sched command
+ *
+ * "sched [-c cpulist] [-n nice] [-b|-i|-o] [-m nodelist] cmd ..." runs
+ * the rest of the command on the CPUs listed, with the given nice
+ * value, under SCHED_BATCH (-b), SCHED_IDLE (-i) or SCHED_OTHER (-o),
+ * and allocating memory only from the NUMA nodes listed. The child
+ * sets all of it on itself before it execs, so the whole job starts
+ * out that way. "sched spread on|off" has every background job that
+ * wasn't given CPUs put on the shell's next CPU, round-robin, and
+ * "sched" alone says whether it is on. Returns the job ID, or 0 if no
+ * job was started.
+ */
+int do_sched(char *line, size_t len, struct tok_t *t, struct tok_t *end,
+	     const struct jobopts_t *opts)
+{
+    struct jobopts_t o = *opts;
+    cpu_set_t nodes;
+    char *arg;
+    int i, opt, given = 0;
+
+    t = t->next;
+    if (t == end) {
+        if (spread.on)
+            printf("sched: spread on over %d CPUs, next job on CPU %d\n",
+                   CPU_COUNT(&spread.cpus), spread.next);
+        else
+            printf("sched: spread off\n");
+        return 0;
+    }
+    if (strcmp(t->s, "spread") == 0 && t->next != end &&
+        t->next->next == end) {
+        if (strcmp(t->next->s, "on") == 0 && !spread.on) {
+            //the CPUs the shell may use are the ones handed out
+            if (sched_getaffinity(0, sizeof(spread.cpus), &spread.cpus) < 0) {
+                printf("sched: %s\n", strerror(errno));
+                return 0;
+            }
+            spread.on = 1;
+            for (spread.next = 0; !CPU_ISSET(spread.next, &spread.cpus); spread.next++)
+                ;
+        }
+        else if (strcmp(t->next->s, "off") == 0) {
+            spread.on = 0;
+        }
+        else if (strcmp(t->next->s, "on") != 0) {
+            printf("usage: sched spread on|off\n");
+        }
+        return 0;
+    }
+    for (; t != end && t->type == T_WORD && t->s[0] == '-' &&
+           strchr("cnbiom", t->s[1]) != NULL && t->s[2] == '\0'; t = t->next) {
+        opt = t->s[1];
+        given = 1;
+        if (opt == 'b' || opt == 'i' || opt == 'o') {
+            o.sched.policy = opt == 'b' ? SCHED_BATCH : opt == 'i' ? SCHED_IDLE :
+                SCHED_OTHER;
+            o.sched.set |= SC_POLICY;
+            continue;
+        }
+        if (t->next == end) {
+            break;
+        }
+        t = t->next;
+        arg = t->s;
+        if (opt == 'n') {
+            o.sched.nice = atoi(arg);
+            o.sched.set |= SC_NICE;
+        }
+        else if (opt == 'c') {
+            if (cpulist(arg, &o.sched.cpus, 1) < 0) {
+                printf("sched: no usable CPU in '%s'\n", arg);
+                return 0;
+            }
+            o.sched.set |= SC_CPUS;
+        }
+        else {
+            //nodes are listed the same way. any node up to 63 is
+            //taken here; the kernel checks that it exists
+            if (cpulist(arg, &nodes, 0) < 0) {
+                printf("sched: bad node list '%s'\n", arg);
+                return 0;
+            }
+            for (o.sched.nodes = 0, i = 0; i < 64; i++) {
+                if (CPU_ISSET(i, &nodes))
+                    o.sched.nodes |= 1UL << i;
+            }
+            o.sched.set |= SC_NODES;
+        }
+    }
+    if (t == end || !given) {
+        printf("usage: sched [-c cpulist] [-n nice] [-b|-i|-o] [-m nodelist] command\n"
+               "       sched spread on|off\n");
+        return 0;
+    }
+    return eval_seg(line, len, t, end, &o);
+}
+
+/*
+ * cpulist - Parse a list of CPUs like 0-3,6 into set. If usable is
+ *    set, CPUs the shell itself may not run on are left out. Returns
+ *    -1 if the list is malformed or nothing is left of it.
+ */
+int cpulist(const char *s, cpu_set_t *set, int usable)
+{
+    cpu_set_t mine;
+    char *end;
+    long lo, hi;
+
+    CPU_ZERO(set);
+    do {
+        if (!isdigit((unsigned char)*s))
+            return -1;
+        lo = hi = strtol(s, &end, 10);
+        if (*end == '-') {
+            if (!isdigit((unsigned char)end[1]))
+                return -1;
+            hi = strtol(end + 1, &end, 10);
+        }
+        if (lo > hi || hi >= CPU_SETSIZE)
+            return -1;
+        for (; lo <= hi; lo++)
+            CPU_SET(lo, set);
+        s = end + 1;
+    } while (*end == ',');
+    if (*end != '\0')
+        return -1;
+    if (usable && sched_getaffinity(0, sizeof(mine), &mine) == 0)
+        CPU_AND(set, set, &mine);
+    return CPU_COUNT(set) > 0 ? 0 : -1;
+}
+
+/*
+ * sched_apply - Give the calling process the attributes sc sets.
+ *    Meant for a child about to exec. Returns -1 after reporting the
+ *    first one that couldn't be set.
+ */
+int sched_apply(const struct sched_t *sc)
+{
+    struct sched_param param = { 0 };
+    const char *what = NULL;
+
+#ifdef SYS_set_mempolicy
+    /* MPOL_BIND; the kernel wants one more than the bits in the mask */
+    if ((sc->set & SC_NODES) &&
+        syscall(SYS_set_mempolicy, 2, &sc->nodes, 8 * sizeof(sc->nodes) + 1) < 0)
+        what = "memory nodes";
+#else
+    if (sc->set & SC_NODES) {
+        errno = ENOSYS;
+        what = "memory nodes";
+    }
+#endif
+    if (what == NULL && (sc->set & SC_CPUS) &&
+        sched_setaffinity(0, sizeof(sc->cpus), &sc->cpus) < 0)
+        what = "CPU affinity";
+    if (what == NULL && (sc->set & SC_POLICY) &&
+        sched_setscheduler(0, sc->policy, &param) < 0)
+        what = "scheduling policy";
+    if (what == NULL && (sc->set & SC_NICE) &&
+        setpriority(PRIO_PROCESS, 0, sc->nice) < 0)
+        what = "nice value";
+    if (what != NULL) {
+        printf("sched: can't set %s: %s\n", what, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * do_ignore_singleton - Display the message to ignore a singleton '&'
+ */
+void do_ignore_singleton(void)
+{   
+	//this is important to making sure the shell doesn't freak out with singleton &'s
+    if(prompt[0] ==  '&'){
+    	//app_error was again another provided function vital in making my life easier
+        app_error("ignoring singleton '&'!");
+    }
+  return;
+}
+
+/*
+ * do_killall - Execute the builtin killall command
+ *
+ * "killall [-g grace] [secs]" tears down every job after secs seconds,
+ * or right away if no time is given. -g sets how many seconds the
+ * jobs get to exit on SIGINT before SIGKILL (default 1).
+ */
+void do_killall(char **argv)
+{
+	//kill all utilizes a timeout killall approach
+	//i.e. the resoning for the timeout alarm value
+	//like alarm() used to, a new killall replaces the pending one
+	//and killall 0 just cancels it
+    int i = 1;
+    if(argv[i] != NULL && strcmp(argv[i], "-g") == 0 && argv[i + 1] != NULL){
+        teardown.grace_ms = atof(argv[i + 1]) * 1000;
+        i += 2;
+    }
+    wt_cancel(&killall_timer);
+    if(argv[i] == NULL){
+        teardown_start();
+        return;
+    }
+    int timeoutAlm = atoi(argv[i]);
+    if(timeoutAlm > 0){
+        killall_timer.fn = killall_expire;
+        wt_add(&killall_timer, timeoutAlm * 1000L);
+    }
+    return;
+}
+
+/*
+ * Teardown sends every job's process group a SIGINT in one pass over
+ * the job table, so grandchildren that share the group (like the
+ * child mysplit forks) go too, and stopped jobs are continued so they
+ * can act on it. The jobs are then reaped by the event loop like any
+ * others while a grace timer runs; whatever is left in the groups
+ * when it fires gets a SIGKILL. A group's ID is only safe to signal
+ * while something holds it: a job still on the list, or a member seen
+ * alive since. So each group is probed as its job goes, and dropped
+ * the first time it is found empty. With -v the time the whole
+ * teardown took is reported.
+ */
+
+/* teardown_start - Signal every job's process group */
+void teardown_start(void)
+{
+    struct job_t *job;
+    uint64_t bits;
+    pid_t *pgids;
+    int w;
+
+    if (teardown.active)
+	return;                     /* the groups already have their SIGINT */
+    clock_gettime(CLOCK_MONOTONIC, &teardown.start);
+    teardown.n = teardown.left = teardown.killed = teardown.expired = 0;
+    teardown.njobs = 0;
+    for (w = 0; w <= jobs->maxjid / 64; w++) {
+	for (bits = jobs->jidmap[w]; bits != 0; bits &= bits - 1) {
+	    job = &jobs->slot[jobs->jidslot[w * 64 + __builtin_ctzll(bits)]];
+	    if (teardown.n == teardown.cap) {
+		int cap = teardown.cap ? 2 * teardown.cap : 64;
+		if ((pgids = realloc(teardown.pgids, cap * sizeof(pid_t))) == NULL)
+		    break;
+		teardown.pgids = pgids;
+		teardown.cap = cap;
+	    }
+	    teardown.pgids[teardown.n++] = job->pid;
+	    job_kill(job, SIGINT);
+	    if (job->state == ST)
+		job_kill(job, SIGCONT);
+	    job->flags |= JF_TEARDOWN;
+	    teardown.left++;
+	    teardown.njobs++;
+	}
+    }
+    if (teardown.n == 0)
+	return;
+    teardown.active = 1;
+    teardown.grace.fn = teardown_grace;
+    wt_add(&teardown.grace, teardown.grace_ms);
+}
+
+/*
+ * teardown_reaped - The last job being torn down is gone. Finish
+ *    unless something outside our children is still in a group and
+ *    hasn't had its SIGKILL yet.
+ */
+void teardown_reaped(void)
+{
+    if (teardown.expired || !teardown_alive())
+	teardown_finish();
+}
+
+/* teardown_grace - The grace period is over: SIGKILL what is left */
+void teardown_grace(struct wtimer_t *t)
+{
+    struct job_t *job;
+    pid_t pgid;
+    int i;
+
+    teardown.expired = 1;
+    for (i = 0; i < teardown.n; ) {
+	pgid = teardown.pgids[i];
+	job = getprocessid(jobs, pgid);
+	if (job != NULL && job->pid == pgid && (job->flags & JF_TEARDOWN)) {
+	    if (job_kill(job, SIGKILL) == 0)
+		teardown.killed++;
+	    i++;
+	} else if (teardown_probe(i)) {
+	    if (kill(-pgid, SIGKILL) == 0)
+		teardown.killed++;
+	    i++;
+	}
+    }
+    if (teardown.left == 0)
+	teardown_finish();
+}
+
+/* teardown_alive - Return 1 if any signalled process group has members */
+int teardown_alive(void)
+{
+    while (teardown.n > 0)
+	if (teardown_probe(teardown.n - 1))
+	    return 1;
+    return 0;
+}
+
+/*
+ * teardown_probe - Return 1 if group i of teardown.pgids still has
+ *    members. If it has none its ID is free for anyone to reuse, so it
+ *    is dropped, with the last entry moving into slot i.
+ */
+int teardown_probe(int i)
+{
+    if (kill(-teardown.pgids[i], 0) == 0 || errno != ESRCH)
+	return 1;
+    teardown.pgids[i] = teardown.pgids[--teardown.n];
+    return 0;
+}
+
+/*
+ * teardown_jobgone - The torn down job led by pgid was just removed.
+ *    Nothing of ours holds its group any more, so look now whether
+ *    anything else does.
+ */
+void teardown_jobgone(pid_t pgid)
+{
+    int i;
+
+    for (i = 0; i < teardown.n; i++)
+	if (teardown.pgids[i] == pgid) {
+	    teardown_probe(i);
+	    return;
+	}
+}
+
+/* teardown_finish - Report the teardown and get ready for the next */
+void teardown_finish(void)
+{
+    wt_cancel(&teardown.grace);
+    teardown.active = 0;
+    if (verbose)
+	printf("killall: %d job%s gone in %.3f ms, %d needed SIGKILL\n",
+	       teardown.njobs, teardown.njobs == 1 ? "" : "s",
+	       elapsed_ns(&teardown.start) / 1e6, teardown.killed);
+}
+
+/* 
+ * do_bgfg - Execute the builtin bg and fg commands
+ */
+void do_bgfg(char **argv) 
+{
+    if((argv[1]) == NULL){
+        //Edge case
+        printf("%s command requires PID or Jjobid argument\n", argv[0]);
+        return;
+    }
+    int piDTrue = 1;
+     //initialize the integer which will behave as a switch for JID or PID
+    //the if statement below will determine if the input is a PID
+    //if it is, it will set piDInput to 1
+    if(isdigit(argv[1][0])!=0){
+        piDTrue=1;
+    }
+    else if((argv[1][0]) == 'J'){
+        piDTrue = 0;      
+    }
+    else{
+        printf("%s argument must be PID or Jjobid\n", argv[0]);
+        return;
+    }
+    pid_t pidVal;
+    struct job_t *job;
+    int jiD;
+    long t0;
+    //all of these intitializations are vital to the final if statement of processing either a JID or PID to do either bg or fg
+    if(piDTrue){
+        pidVal = atoi(argv[1]);
+        job = getprocessid(jobs, pidVal);
+        if(job == NULL){
+            printf("(%s): No such process\n", argv[1]);
+            return;
+        }
+    }
+    //this else pertains to whether the argument was a PID or JID argument from the user
+    //this means in this else statement it is processing a JID argument
+    else{
+        jiD = atoi(&argv[1][1]);
+        job = getjobid(jobs,jiD);
+        if(job == NULL){
+            printf("%s: No such job\n", argv[1]);
+            return;
+        }
+        pidVal = job->pid;
+    }
+    //using a simple strcmp we can determine if the user inputted the bg or fg command
+    //in this if statement, if it is entered, it follows that it will utilize sigcont and kill the process and report the jid, pid, cmdline and then set the job state
+    //the trace records how long the SIGCONT took to send
+    t0 = trace.on ? mono_ns() : 0;
+    job_kill(job, SIGCONT);
+    if(t0 != 0){
+        trace_event(TE_CONT, pidVal, job->jid, mono_ns() - t0);
+    }
+    if(strcmp(argv[0], "bg") ==0){
+        printf("[%d] (%d) %s", job->jid, job->pid,job->cmdline);
+        setjobstate(jobs, job, BG);
+    }
+    else{
+    	//it will do the same prtocess as the if statement before except
+    	//it will perform a waitFG as the command was indicated that it should be run in the foreground.
+    	//wait on the job's leader, since a member PID leaves the index when that member is reaped
+        setjobstate(jobs, job, FG);
+        waitfg(job->pid);
+    }
+    return;
+}
+
+/*
+ * do_hash - Execute the builtin hash command
+ *
+ * "hash" lists the remembered command locations, "hash -r" forgets
+ * them all and "hash name..." looks each name up and remembers it.
+ */
+void do_hash(char **argv)
+{
+    struct pathent_t *ent;
+    int i, empty = 1;
+
+    if (argv[1] != NULL && strcmp(argv[1], "-r") == 0) {
+        path_flush();
+        return;
+    }
+    if (argv[1] != NULL) {
+        for (i = 1; argv[i] != NULL; i++) {
+            if (strchr(argv[i], '/') != NULL)
+                continue;
+            if (path_lookup(argv[i], 0) == NULL)
+                printf("hash: %s: not found\n", argv[i]);
+        }
+        return;
+    }
+
+    path_validate();
+    for (i = 0; i < HASHSIZE; i++) {
+        for (ent = pathtab[i]; ent != NULL; ent = ent->next) {
+            if (empty)
+                printf("hits\tcommand\n");
+            empty = 0;
+            printf("%4ld\t%s\n", ent->hits, ent->path);
+        }
+    }
+    if (empty)
+        printf("hash: hash table empty\n");
+}
+
+/*
+ * do_parallel - Execute the builtin parallel command
+ *
+ * "parallel -j N file" runs the command lines in file (or stdin for
+ * "-") as background jobs, keeping N of them in flight: the next line
+ * starts as soon as sigchld_handler reaps a worker. Workers are
+ * ordinary jobs, so they show up in the job list. Ctrl-c stops
+ * starting new lines and interrupts the running ones. A throughput
+ * and latency summary is printed at the end.
+ */
+void do_parallel(char **argv)
+{
+    char *buf = NULL, *file;
+    size_t size = 0, n;
+    struct timespec t0, t1;
+    struct stat st;
+    struct job_t *job;
+    uint64_t bits;
+    double secs;
+    int i = 1, fd, w, limit = 0;
+
+    if (argv[i] != NULL && strncmp(argv[i], "-j", 2) == 0) {
+	if (argv[i][2] != '\0')
+	    limit = atoi(&argv[i][2]);
+	else if (argv[++i] != NULL)
+	    limit = atoi(argv[i]);
+	i++;
+    }
+    if (limit < 1 || (file = argv[i]) == NULL) {
+	printf("usage: parallel -j N <file|->\n");
+	return;
+    }
+
+    /* load the command list */
+    if (strcmp(file, "-") == 0) {
+	/* through the shell's own reader, which may hold some already */
+	buf = input_rest(&input, &size);
+    } else {
+	if ((fd = open(file, O_RDONLY | O_CLOEXEC)) < 0 || fstat(fd, &st) < 0) {
+	    printf("%s: %s\n", file, strerror(errno));
+	    return;
+	}
+	size = st.st_size;
+	buf = size ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+			  fd, 0) : NULL;
+	close(fd);
+	if (buf == MAP_FAILED) {
+	    printf("%s: %s\n", file, strerror(errno));
+	    return;
+	}
+    }
+
+    memset(&par, 0, sizeof(par));
+    par.limit = limit;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (size > 0)
+	eval_lines(buf, size, parallel_one);
+
+    if (par.interrupted) {
+	/* stop the workers still running */
+	for (w = 0; w <= jobs->maxjid / 64; w++) {
+	    for (bits = jobs->jidmap[w]; bits != 0; bits &= bits - 1) {
+		job = getjobid(jobs, w * 64 + __builtin_ctzll(bits));
+		if (job->flags & JF_PARALLEL)
+		    job_kill(job, SIGINT);
+	    }
+	}
+    }
+    par.interrupted = 0;
+    waitslots(0);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    n = par.finished;
+    printf("parallel: %ld jobs in %.3f s (%.1f jobs/s), latency avg %.3f ms, max %.3f ms\n",
+	   (long)n, secs, secs > 0 ? n / secs : 0.0,
+	   n ? par.total_ns / (double)n / 1e6 : 0.0, par.max_ns / 1e6);
+    par.limit = 0;
+    if (strcmp(file, "-") == 0)
+	free(buf);
+    else if (size > 0)
+	munmap(buf, size);
+}
+
+/* parallel_one - Start one parallel worker once a slot is free */
+void parallel_one(char *cmdline, size_t len)
+{
+    static const struct jobopts_t o = { JF_PARALLEL };
+
+    waitslots(par.limit - 1);
+    if (par.interrupted)
+	return;
+    if (eval_job(cmdline, len, &o) != 0)
+	par.started++;
+}
+
+/*
+ * do_trace - Execute the builtin trace command
+ *
+ *     trace on [file]    start recording lifecycle events; with a file,
+ *                        the ring is appended to it as JSON lines
+ *                        whenever it fills, and at exit
+ *     trace off          stop recording (and flush to the file)
+ *     trace dump [file]  write the events still in the ring as JSON
+ *                        lines to file, or to stdout
+ *     trace stats        per-phase counts, latencies and histograms
+ */
+void do_trace(char **argv)
+{
+    FILE *fp;
+
+    if (argv[1] == NULL) {
+	printf("usage: trace on [file] | off | dump [file] | stats\n");
+    } else if (strcmp(argv[1], "on") == 0) {
+	if (argv[2] != NULL) {
+	    if ((fp = fopen(argv[2], "ae")) == NULL) {
+		printf("%s: %s\n", argv[2], strerror(errno));
+		return;
+	    }
+	    if (trace.out != NULL) {
+		trace_flush();
+		fclose(trace.out);
+	    } else {
+		atexit(trace_flush);
+	    }
+	    trace.out = fp;
+	    trace.flushed = trace.head;
+	}
+	trace.on = 1;
+    } else if (strcmp(argv[1], "off") == 0) {
+	trace.on = 0;
+	trace_flush();
+    } else if (strcmp(argv[1], "dump") == 0) {
+	if (argv[2] == NULL) {
+	    trace_write(stdout, trace.head - TRACESIZE, trace.head);
+	} else if ((fp = fopen(argv[2], "we")) == NULL) {
+	    printf("%s: %s\n", argv[2], strerror(errno));
+	} else {
+	    trace_write(fp, trace.head - TRACESIZE, trace.head);
+	    fclose(fp);
+	}
+    } else if (strcmp(argv[1], "stats") == 0) {
+	trace_stats();
+    } else {
+	printf("usage: trace on [file] | off | dump [file] | stats\n");
+    }
+}
+
+/*
+ * do_echo - Execute the builtin echo command, as coreutils echo does:
+ *    -n leaves off the newline, -e decodes backslash escapes (\c ends
+ *    the output there) and -E stops decoding them. An argument that
+ *    isn't made of those letters, and everything after it, is echoed.
+ */
+void do_echo(char **argv)
+{
+    int newline = 1, escapes = 0, i;
+    char *p;
+
+    for (i = 1; argv[i] != NULL && argv[i][0] == '-' && argv[i][1] != '\0';
+	 i++) {
+	p = argv[i] + 1 + strspn(argv[i] + 1, "neE");
+	if (*p != '\0')
+	    break;
+	for (p = argv[i] + 1; *p != '\0'; p++) {
+	    if (*p == 'n')
+		newline = 0;
+	    else
+		escapes = (*p == 'e');
+	}
+    }
+    for (; argv[i] != NULL; i++) {
+	if (!escapes)
+	    fputs(argv[i], stdout);
+	else if (putescaped(argv[i], 1) < 0)
+	    return;
+	if (argv[i + 1] != NULL)
+	    putchar(' ');
+    }
+    if (newline)
+	putchar('\n');
+}
+
+/*
+ * do_printf - Execute the builtin printf command: %s %b %q %c %d %i
+ *    %o %u %x %X %e %f %g (with flags, width and precision, either of
+ *    which can be a * taken from the arguments) and %%, and the
+ *    format's own backslash escapes. A numeric argument starting with
+ *    a quote is the value of the character after it. The format is
+ *    reused while arguments are left, as POSIX asks; missing ones are
+ *    empty or 0.
+ */
+void do_printf(char **argv)
+{
+    char spec[64], *p, *q, *a, **arg, **before, c;
+    size_t n, k;
+    int used;
+
+    if (argv[1] == NULL) {
+	printf("printf: missing operand\n");
+	laststatus = 1;
+	return;
+    }
+    arg = argv + 2;
+    do {
+	before = arg;
+	for (p = argv[1]; *p != '\0'; p++) {
+	    if (*p == '\\') {
+		if ((used = unescape(p + 1, 0, &c)) < 0)
+		    return;
+		putchar(c);
+		p += used;
+		continue;
+	    }
+	    if (*p != '%') {
+		putchar(*p);
+		continue;
+	    }
+	    if (p[1] == '%') {
+		putchar('%');
+		p++;
+		continue;
+	    }
+	    /* flags, width and precision are handed on to printf(3) */
+	    q = p + 1 + strspn(p + 1, "-+ #0");
+	    q += *q == '*' ? 1 : strspn(q, "0123456789");
+	    if (*q == '.')
+		q += 1 + (q[1] == '*' ? 1 : strspn(q + 1, "0123456789"));
+	    if (q - p > 16 || *q == '\0' ||
+		strchr("sbqcdiouxXeEfFgG", *q) == NULL) {
+		printf("printf: %.*s: invalid conversion\n", (int)(q - p + 1), p);
+		laststatus = 1;
+		return;
+	    }
+	    /* copy the spec over, with each * replaced by its argument */
+	    for (n = 0, a = p; a < q; a++) {
+		if (*a != '*') {
+		    spec[n++] = *a;
+		    continue;
+		}
+		k = sprintf(spec + n, "%d", (int)intarg(*arg != NULL ? *arg++ : ""));
+		n += k;
+	    }
+	    a = *arg != NULL ? *arg++ : "";
+	    switch (*q) {
+	    case 's':
+		strcpy(spec + n, "s");
+		printf(spec, a);
+		break;
+	    case 'q':
+		strcpy(spec + n, "s");
+		printf(spec, shquote(a));
+		break;
+	    case 'b':
+		if (putescaped(a, 1) < 0)
+		    return;
+		break;
+	    case 'c':
+		strcpy(spec + n, "c");
+		if (*a != '\0')
+		    printf(spec, *a);
+		break;
+	    case 'd': case 'i':
+		sprintf(spec + n, "ll%c", *q);
+		printf(spec, intarg(a));
+		break;
+	    case 'o': case 'u': case 'x': case 'X':
+		sprintf(spec + n, "ll%c", *q);
+		printf(spec, uintarg(a));
+		break;
+	    default:
+		sprintf(spec + n, "%c", *q);
+		printf(spec, floatarg(a));
+		break;
+	    }
+	    p = q;
+	}
+    } while (*arg != NULL && arg != before);
+}
+
+/*
+ * do_test - Execute the builtin test command, or [ (which wants a
+ *    closing ]). The status is 0 if the expression holds, 1 if not and
+ *    2 if it couldn't be understood.
+ */
+void do_test(char **argv)
+{
+    size_t len = strlen(argv[0]);
+    int argc, r;
+
+    for (argc = 0; argv[argc] != NULL; argc++)
+	;
+    if (argv[0][len - 1] == '[') {
+	if (strcmp(argv[argc - 1], "]") != 0) {
+	    printf("[: missing ']'\n");
+	    laststatus = 2;
+	    return;
+	}
+	argc--;
+    }
+    r = testexpr(argv + 1, argc - 1);
+    laststatus = r < 0 ? 2 : !r;
+}
+
+/*
+ * testexpr - Evaluate the test expression in the argc words at argv.
+ *    Up to four words are read by the POSIX rules, which decide by
+ *    the number of words whether a word like "=" or "(" is an
+ *    operator; longer ones by the grammar below. Returns 1 (true), 0
+ *    (false) or -1 after reporting an error.
+ */
+int testexpr(char **argv, int argc)
+{
+    int r, i = 0;
+
+    switch (argc) {
+    case 0:
+	return 0;
+    case 1:
+	return argv[0][0] != '\0';
+    case 2:
+	if (strcmp(argv[0], "!") == 0)
+	    return argv[1][0] == '\0';
+	return testunary(argv[0], argv[1]);
+    case 3:
+	if (testbinop(argv[1]) || strcmp(argv[1], "-a") == 0 ||
+	    strcmp(argv[1], "-o") == 0)
+	    return testbinary(argv[0], argv[1], argv[2]);
+	if (strcmp(argv[0], "!") == 0)
+	    return (r = testexpr(argv + 1, 2)) < 0 ? r : !r;
+	if (strcmp(argv[0], "(") == 0 && strcmp(argv[2], ")") == 0)
+	    return argv[1][0] != '\0';
+	printf("test: %s: binary operator expected\n", argv[1]);
+	return -1;
+    case 4:
+	if (strcmp(argv[0], "!") == 0)
+	    return (r = testexpr(argv + 1, 3)) < 0 ? r : !r;
+	if (strcmp(argv[0], "(") == 0 && strcmp(argv[3], ")") == 0)
+	    return testexpr(argv + 1, 2);
+	break;
+    }
+    if ((r = testor(argv, argc, &i)) >= 0 && i < argc) {
+	printf("test: %s: unexpected argument\n", argv[i]);
+	return -1;
+    }
+    return r;
+}
+
+/*
+ * testor, testand, testnot, testprim - Evaluate the longest test
+ *    expression starting at argv[*i], leaving *i just past it:
+ *
+ *	or   := and { -o and }
+ *	and  := not { -a not }
+ *	not  := ! not | prim
+ *	prim := ( or ) | unary-op word | word binary-op word | word
+ *
+ *    Every operand is evaluated, so an error anywhere is reported.
+ */
+int testor(char **argv, int argc, int *i)
+{
+    int r, s;
+
+    if ((r = testand(argv, argc, i)) < 0)
+	return r;
+    while (*i < argc && strcmp(argv[*i], "-o") == 0) {
+	(*i)++;
+	if ((s = testand(argv, argc, i)) < 0)
+	    return s;
+	r = r || s;
+    }
+    return r;
+}
+
+int testand(char **argv, int argc, int *i)
+{
+    int r, s;
+
+    if ((r = testnot(argv, argc, i)) < 0)
+	return r;
+    while (*i < argc && strcmp(argv[*i], "-a") == 0) {
+	(*i)++;
+	if ((s = testnot(argv, argc, i)) < 0)
+	    return s;
+	r = r && s;
+    }
+    return r;
+}
+
+int testnot(char **argv, int argc, int *i)
+{
+    int r;
+
+    if (*i < argc && strcmp(argv[*i], "!") == 0) {
+	(*i)++;
+	return (r = testnot(argv, argc, i)) < 0 ? r : !r;
+    }
+    return testprim(argv, argc, i);
+}
+
+int testprim(char **argv, int argc, int *i)
+{
+    char **w = argv + *i;
+    int left = argc - *i, r;
+
+    if (left == 0) {
+	printf("test: argument expected\n");
+	return -1;
+    }
+    if (left >= 3 && testbinop(w[1])) {
+	*i += 3;
+	return testbinary(w[0], w[1], w[2]);
+    }
+    if (strcmp(w[0], "(") == 0) {
+	(*i)++;
+	if ((r = testor(argv, argc, i)) < 0)
+	    return r;
+	if (*i >= argc || strcmp(argv[*i], ")") != 0) {
+	    printf("test: ')' expected\n");
+	    return -1;
+	}
+	(*i)++;
+	return r;
+    }
+    if (left >= 2 && w[0][0] == '-' && w[0][1] != '\0' && w[0][2] == '\0' &&
+	strchr("zndefsrwxLh", w[0][1]) != NULL) {
+	*i += 2;
+	return testunary(w[0], w[1]);
+    }
+    (*i)++;
+    return w[0][0] != '\0';
+}
+
+/* testbinop - Is op one of test's comparison operators? */
+int testbinop(const char *op)
+{
+    static const char *ops[] = { "=", "==", "!=", "-eq", "-ne", "-lt",
+				 "-le", "-gt", "-ge" };
+    size_t i;
+
+    for (i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+	if (strcmp(op, ops[i]) == 0)
+	    return 1;
+    return 0;
+}
+
+/* testunary - Evaluate the unary file or string test "op arg" */
+int testunary(const char *op, const char *arg)
+{
+    struct stat st;
+
+    if (op[0] != '-' || op[1] == '\0' || op[2] != '\0' ||
+	strchr("zndefsrwxLh", op[1]) == NULL) {
+	printf("test: %s: unary operator expected\n", op);
+	return -1;
+    }
+    switch (op[1]) {
+    case 'z': return arg[0] == '\0';
+    case 'n': return arg[0] != '\0';
+    case 'r': return access(arg, R_OK) == 0;
+    case 'w': return access(arg, W_OK) == 0;
+    case 'x': return access(arg, X_OK) == 0;
+    case 'L':
+    case 'h': return lstat(arg, &st) == 0 && S_ISLNK(st.st_mode);
+    }
+    if (stat(arg, &st) < 0)
+	return 0;
+    switch (op[1]) {
+    case 'd': return S_ISDIR(st.st_mode);
+    case 'f': return S_ISREG(st.st_mode);
+    case 's': return st.st_size > 0;
+    }
+    return 1;                       /* -e */
+}
+
+/*
+ * testbinary - Evaluate "x op y" for a binary operator op: a string or
+ *    integer comparison, or -a / -o of the two words as strings
+ */
+int testbinary(const char *x, const char *op, const char *y)
+{
+    static const char *intops[] = { "-eq", "-ne", "-lt", "-le", "-gt", "-ge" };
+    long a, b;
+    char *endp;
+    int i;
+
+    if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0)
+	return strcmp(x, y) == 0;
+    if (strcmp(op, "!=") == 0)
+	return strcmp(x, y) != 0;
+    if (strcmp(op, "-a") == 0)
+	return x[0] != '\0' && y[0] != '\0';
+    if (strcmp(op, "-o") == 0)
+	return x[0] != '\0' || y[0] != '\0';
+    for (i = 0; i < 6 && strcmp(op, intops[i]) != 0; i++)
+	;
+    a = strtol(x, &endp, 10);
+    if (x[0] == '\0' || *endp != '\0') {
+	printf("test: %s: integer expression expected\n", x);
+	return -1;
+    }
+    b = strtol(y, &endp, 10);
+    if (y[0] == '\0' || *endp != '\0') {
+	printf("test: %s: integer expression expected\n", y);
+	return -1;
+    }
+    switch (i) {
+    case 0: return a == b;
+    case 1: return a != b;
+    case 2: return a < b;
+    case 3: return a <= b;
+    case 4: return a > b;
+    default: return a >= b;
+    }
+}
+
+/*
+ * do_cd - Execute the builtin cd command: change to dir, to $HOME
+ *    without one, or back to $OLDPWD (printing it) for "cd -". PWD
+ *    and OLDPWD are kept up to date for the commands we run.
+ */
+void do_cd(char **argv)
+{
+    char old[PATH_MAX], cwd[PATH_MAX], *dir = argv[1];
+    int i;
+
+    if (dir == NULL && (dir = var_get("HOME")) == NULL) {
+	printf("cd: HOME not set\n");
+	laststatus = 1;
+	return;
+    }
+    if (strcmp(dir, "-") == 0 && (dir = var_get("OLDPWD")) == NULL) {
+	printf("cd: OLDPWD not set\n");
+	laststatus = 1;
+	return;
+    }
+    if (getcwd(old, sizeof(old)) == NULL)
+	old[0] = '\0';
+    if (chdir(dir) < 0) {
+	printf("cd: %s: %s\n", dir, strerror(errno));
+	laststatus = 1;
+	return;
+    }
+    if (old[0] != '\0')
+	var_set("OLDPWD", 6, old, 1);
+    if (getcwd(cwd, sizeof(cwd)) != NULL) {
+	var_set("PWD", 3, cwd, 1);
+	if (argv[1] != NULL && strcmp(argv[1], "-") == 0)
+	    printf("%s\n", cwd);
+    }
+    /* commands found through a relative PATH entry are elsewhere now */
+    for (i = 0; i < npathdirs; i++) {
+	if (pathdirs[i].dir[0] != '/') {
+	    pathdirs[i].listed = 0;
+	    path_flush();
+	}
+    }
+}
+
+/* do_pwd - Execute the builtin pwd command */
+void do_pwd(char **argv)
+{
+    char cwd[PATH_MAX];
+
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+	printf("pwd: %s\n", strerror(errno));
+	laststatus = 1;
+	return;
+    }
+    printf("%s\n", cwd);
+}
+
+/*
+ * do_history - Execute the builtin history command
+ *     history            list every command, numbered
+ *     history N          list the last N
+ *     history -s text    list the commands containing text
+ *     history -f file    keep the history in file from now on
+ */
+void do_history(char **argv)
+{
+    const char *s, *hit, *lim;
+    size_t n, len;
+    long e, nents;
+    char *end;
+
+    if (argv[1] != NULL && strcmp(argv[1], "-f") == 0 && argv[2] != NULL) {
+	if (hist_open(argv[2]) < 0)
+	    laststatus = 1;
+	return;
+    }
+    if (hist.fd < 0) {
+	printf("history: no history file\n");
+	laststatus = 1;
+	return;
+    }
+    nents = hist_sync();
+    if (argv[1] != NULL && strcmp(argv[1], "-s") == 0 && argv[2] != NULL) {
+	/* the mapping is searched directly, one entry per hit */
+	n = strlen(argv[2]);
+	lim = hist.map + hist.indexed;
+	for (s = hist.map; s < lim; s = hist.map + hist.off[e] + len + 1) {
+	    if ((hit = memmem(s, lim - s, argv[2], n)) == NULL)
+		break;
+	    e = hist_entryat(hit - hist.map);
+	    hist_entry(e, &len);
+	    printf("%5ld  %.*s\n", e + 1, (int)len, hist.map + hist.off[e]);
+	}
+	return;
+    }
+    e = 0;
+    if (argv[1] != NULL) {
+	e = nents - strtol(argv[1], &end, 10);
+	if (*end != '\0' || argv[1][0] == '\0' || argv[1][0] == '-') {
+	    printf("usage: history [N] | -s text | -f file\n");
+	    laststatus = 1;
+	    return;
+	}
+    }
+    for (e = e < 0 ? 0 : e; e < nents; e++) {
+	s = hist_entry(e, &len);
+	printf("%5ld  %.*s\n", e + 1, (int)len, s);
+    }
+}
+
+/*
+ * do_export - Execute the builtin export command: export NAME=value
+ *    sets and exports, export NAME exports (an unset NAME as empty),
+ *    and export on its own lists what is exported
+ */
+void do_export(char **argv)
+{
+    struct var_t *v;
+    char **list, *eq;
+    int i, n = 0;
+
+    if (argv[1] == NULL) {
+	for (i = 0; i < VARHASH; i++)
+	    for (v = vartab[i]; v != NULL; v = v->next)
+		n += v->exported;
+	if ((list = malloc((n + 1) * sizeof(char *))) == NULL)
+	    unix_error("do_export: malloc");
+	for (i = 0, n = 0; i < VARHASH; i++)
+	    for (v = vartab[i]; v != NULL; v = v->next)
+		if (v->exported)
+		    list[n++] = v->str;
+	qsort(list, n, sizeof(char *), cmpstr);
+	for (i = 0; i < n; i++)
+	    printf("export %s\n", list[i]);
+	free(list);
+	return;
+    }
+    for (i = 1; argv[i] != NULL; i++) {
+	if ((eq = strchr(argv[i], '=')) != NULL) {
+	    if (var_set(argv[i], eq - argv[i], eq + 1, 1) < 0)
+		laststatus = 1;
+	} else if ((v = var_find(argv[i], strlen(argv[i]))) != NULL) {
+	    envdirty |= !v->exported;
+	    v->exported = 1;
+	} else if (var_set(argv[i], strlen(argv[i]), "", 1) < 0) {
+	    laststatus = 1;
+	}
+    }
+}
+
+/* do_unset - Execute the builtin unset command */
+void do_unset(char **argv)
+{
+    int i;
+
+    for (i = 1; argv[i] != NULL; i++)
+	var_unset(argv[i]);
+}
+
+/*
+ * do_output - Execute the builtin output command
+ *
+ * "output J<n>" prints what background job n has written to its
+ * stdout so far, and "output J<n> -f" keeps printing what it writes
+ * until it closes its stdout or ctrl-c is typed. The output of a job
+ * that is gone is kept until another captured job gets its job ID. "output on"
+ * and "output off" start and stop capturing the output of jobs
+ * started with &, and "output" alone lists what has been captured.
+ */
+void do_output(char **argv)
+{
+    struct outbuf_t *o;
+    size_t shown;
+
+    if(argv[1] == NULL){
+        printf("output capture %s\n", capture ? "on" : "off");
+        for(o = outbufs; o != NULL; o = o->next){
+            printf("[%d] %zu bytes%s%s\n", o->jid, o->len,
+                   o->spill >= 0 ? " (on disk)" : "", o->fd >= 0 ? ", open" : "");
+        }
+        return;
+    }
+    if(strcmp(argv[1], "on") == 0 || strcmp(argv[1], "off") == 0){
+        capture = argv[1][1] == 'n';
+        return;
+    }
+    if(argv[1][0] != 'J' || (argv[2] != NULL && strcmp(argv[2], "-f") != 0)){
+        printf("usage: output [on|off|J<n> [-f]]\n");
+        laststatus = 2;
+        return;
+    }
+    if((o = out_find(atoi(&argv[1][1]))) == NULL){
+        printf("%s: No output\n", argv[1]);
+        laststatus = 1;
+        return;
+    }
+    //take whatever is sitting in the pipe first
+    if(o->fd >= 0){
+        out_ready(o->src);
+    }
+    out_show(o, 0);
+    if(argv[2] == NULL){
+        return;
+    }
+    //follow it from the event loop like waitfg does, printing each
+    //new piece as it comes in
+    following = 1;
+    for(shown = o->len; o->fd >= 0 && following; shown = o->len){
+        ev_wait(-1);
+        //the job's ID could have been reused, and o freed, meanwhile
+        if(out_find(atoi(&argv[1][1])) != o){
+            break;
+        }
+        out_show(o, shown);
+    }
+    following = 0;
+}
+
+/*
+ * waitslots - Sleep until at most most parallel workers are running,
+ *    or until ctrl-c interrupts the parallel run
+ */
+void waitslots(int most)
+{
+    while (par.running > most && !par.interrupted)
+        ev_wait(-1);
+}
+
+/* 
+ * waitfg - Block until process pid is no longer the foreground process
+ *
+ * The shell sleeps in the event loop, which runs sigchld_handler as
+ * soon as the job is reaped or stopped, instead of polling for it.
+ * A captured background job brought to the foreground has its new
+ * output printed as it arrives.
+ */
+void waitfg(pid_t pid)
+{
+    struct job_t *job;
+    struct outbuf_t *o = NULL;
+    struct timespec now;
+    size_t shown = 0;
+    long ns;
+    int jid = 0;
+
+    //only output this very job captured, not an older job's with its ID
+    if ((job = getprocessid(jobs, pid)) != NULL && (o = out_find(job->jid)) != NULL) {
+        if (o->pgid == job->pid) {
+            jid = job->jid;
+            shown = o->len;
+        } else {
+            o = NULL;
+        }
+    }
+    while ((job = getprocessid(jobs, pid)) != NULL && job->state == FG) {
+        ev_wait(-1);
+        if (o != NULL && out_find(jid) == o) {
+            out_show(o, shown);
+            shown = o->len;
+        }
+    }
+    if (o != NULL && out_find(jid) == o) {
+        if (o->fd >= 0)
+            out_ready(o->src);
+        out_show(o, shown);
+    }
+
+    /* charge the time between the state change and our wakeup */
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ns = (now.tv_sec - fg_changed.tv_sec) * 1000000000L
+        + (now.tv_nsec - fg_changed.tv_nsec);
+    if (fg_changed.tv_sec != 0 && ns >= 0) {
+        fgstats.waits++;
+        fgstats.total_ns += ns;
+        if (ns > fgstats.max_ns)
+            fgstats.max_ns = ns;
+    }
+    fg_changed.tv_sec = fg_changed.tv_nsec = 0;
+    return;
+}
+
+/*
+ * run_script - Execute every line of a script file (tsh script.tsh)
+ *
+ * The file is mapped rather than read, and each line is handed to
+ * eval where it lies in the mapping: the byte after its newline is
+ * set to NUL for the duration of the call and then put back. The
+ * mapping is private, so the file itself is never changed, but that
+ * write copies every page a line ends in, which for any ordinary
+ * script is all of them: what the mapping saves is the read() loop
+ * and a line-length limit, not memory. There is no prompt, and
+ * stdout is fully buffered; launch_job flushes it before each child
+ * starts, so output still comes out in order.
+ */
+void run_script(const char *file)
+{
+    static char outbuf[1 << 16];
+    char *map;
+    struct stat st;
+    int fd;
+
+    if ((fd = open(file, O_RDONLY | O_CLOEXEC)) < 0 || fstat(fd, &st) < 0) {
+        printf("%s: %s\n", file, strerror(errno));
+        exit(1);
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        unix_error("mmap error");
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    setvbuf(stdout, outbuf, _IOFBF, sizeof(outbuf));
+
+    eval_lines(map, st.st_size, eval);
+    fflush(stdout);
+    munmap(map, st.st_size);
+}
+
+/*
+ * eval_lines - Call fn on each line of the size bytes at buf, where
+ *    each line is NUL-terminated in place (see run_script). The bytes
+ *    must be writable. Lines can be any length.
+ */
+void eval_lines(char *buf, size_t size, void (*fn)(char *cmdline, size_t len))
+{
+    char *line, *nl, *end = buf + size, *copy, saved;
+    size_t len;
+
+    for (line = buf; line < end; line = nl + 1) {
+        if ((nl = memchr(line, '\n', end - line)) == NULL)
+            nl = end - 1;       /* unterminated last line */
+        len = nl - line + 1;
+        if (*nl != '\n' || nl + 1 == end) {
+            /* nothing after this line to borrow: give it its own copy */
+            if ((copy = malloc(len + 2)) == NULL)
+                unix_error("malloc error");
+            memcpy(copy, line, len);
+            if (*nl != '\n')
+                copy[len++] = '\n';
+            copy[len] = '\0';
+            fn(copy, len);
+            free(copy);
+            continue;
+        }
+        saved = nl[1];
+        nl[1] = '\0';
+        fn(line, len);
+        nl[1] = saved;
+    }
+}
+
+/*
+ * report_fgstats - With -v, summarize how long the shell took to
+ *    get back to the prompt after foreground jobs finished or stopped
+ */
+void report_fgstats(void)
+{
+    if (!verbose || fgstats.waits == 0)
+        return;
+    printf("waitfg: %ld waits, avg wakeup %ld us, max %ld us\n",
+           fgstats.waits, fgstats.total_ns / fgstats.waits / 1000,
+           fgstats.max_ns / 1000);
+}
+
+/*****************
+ * Signal handlers
+ *
+ * None of these run asynchronously. The signals are blocked and
+ * sig_ready calls the handlers from the event loop, so they are free
+ * to print and to change the job list.
+ *****************/
+
+/* 
+ * sigchld_handler - The kernel sends a SIGCHLD to the shell whenever
+ *     a child job terminates (becomes a zombie), or stops because it
+ *     received a SIGSTOP or SIGTSTP signal. Children are reaped when
+ *     their pidfd says they have exited (proc_ready), so all that is
+ *     left here is noting the ones that stopped. Only if some job
+ *     process has no pidfd does this reap all available zombie
+ *     children itself, without waiting for any other currently
+ *     running children to terminate. However many SIGCHLDs one pass of
+ *     the event loop picks up, this runs once.
+ */
+void sigchld_handler(int sig) 
+{
+    pid_t pidVal;
+    int stVal;
+    struct rusage ru;
+    siginfo_t si;
+    //waitid with only WSTOPPED reports stopped children and leaves
+    //the dead ones alone, so nothing gets reaped behind a pidfd's back
+    if(untracked == 0)
+    {
+        for(;;)
+        {
+            si.si_pid = 0;
+            if(waitid(P_ALL, 0, &si, WSTOPPED|WNOHANG) < 0 || si.si_pid == 0)
+            {
+                break;
+            }
+            child_stopped(si.si_pid, si.si_status);
+        }
+        return;
+    }
+    //because there are multiple children possible
+    //we need to utilize a while statement in order to properly 
+    //stop, reap zombie children, or kill due to a SIGINT 
+    //wait4 also hands back what the reaped child used
+    while ((pidVal = wait4(-1, &stVal, WNOHANG|WUNTRACED, &ru)) > 0)
+    {
+        if(WIFSTOPPED(stVal))
+        {
+            child_stopped(pidVal, WSTOPSIG(stVal));
+        }
+        else
+        {
+            child_reaped(pidVal, stVal, &ru);
+        }
+    }
+    return;
+}
+
+/*
+ * child_stopped - Record that job process pid was stopped by sig.
+ *    Every stage of a pipeline stops, but the job is reported once.
+ */
+void child_stopped(pid_t pid, int sig)
+{
+    struct job_t *job = getprocessid(jobs, pid);
+
+    if(job == NULL || job->state == ST)
+    {
+        return;
+    }
+    //stamp the change before touching the job so waitfg can measure
+    //how long it took to notice a foreground job stopping
+    if(job->state == FG)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &fg_changed);
+    }
+    //the child really is stopped now, so this is the place to
+    //record it rather than when ctrl-z was forwarded
+    printf("Job [%d] (%d) stopped by signal %d\n", job->jid, job->pid, sig);
+    setjobstate(jobs, job, ST);
+    if(trace.on)
+    {
+        trace_event(TE_STOP, job->pid, job->jid, mono_ns() - sigread_ns);
+    }
+}
+
+/*
+ * child_reaped - Account for job process pid, just reaped with wait
+ *    status status after using ru, and finish its job if it was the
+ *    last one
+ */
+void child_reaped(pid_t pid, int status, struct rusage *ru)
+{
+    struct job_t *job = getprocessid(jobs, pid);
+    int i;
+
+    if(job == NULL)
+    {
+        return;
+    }
+    //stamp the change before touching the job so waitfg can measure
+    //how long it took to notice a foreground job finishing
+    if(job->state == FG)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &fg_changed);
+    }
+    //its pidfd is done with
+    for(i = 0; i < job->nprocs && job->procs[i] != pid; i++)
+        ;
+    if(i < job->nprocs)
+    {
+        if(job->pidfds[i] != NULL)
+            pidfd_close(job, i);
+        else
+            untracked--;
+    }
+    //like the exit status, a pipeline's fate is that of its last
+    //command, so an upstream stage dying of SIGPIPE isn't reported
+    if(WIFSIGNALED(status) && pid == job->procs[job->nprocs - 1])
+    {
+        job->termsig = WTERMSIG(status);
+    }
+    //and that is the status the shell remembers for a foreground job
+    if(pid == job->procs[job->nprocs - 1] && job->state == FG)
+    {
+        laststatus = WIFSIGNALED(status) ? 128 + WTERMSIG(status) : WEXITSTATUS(status);
+    }
+    addusage(&job->usage, ru);
+    //how long after the signalfd read (or the pidfd wakeup) this
+    //child got reaped
+    if(trace.on)
+    {
+        trace_event(TE_REAP, pid, job->jid, mono_ns() - sigread_ns);
+    }
+    //a pipeline only finishes when its last process has been reaped
+    if(procdone(jobs, pid) == NULL)
+    {
+        if(job->termsig != 0)
+        {
+            printf("Job [%d] (%d) terminated by signal %d\n", job->jid, job->pid, job->termsig);
+        }
+        //time and -v want to know what the whole job used
+        if((job->flags & JF_TIMED) || verbose)
+        {
+            fmtusage(sbuf, sizeof(sbuf), &job->usage, elapsed_ns(&job->start));
+            if(job->flags & JF_TIMED)
+                printf("%s\n", sbuf);
+            else
+                printf("Job [%d] (%d) %s\n", job->jid, job->pid, sbuf);
+        }
+        if(job->flags & JF_PARALLEL)
+        {
+            parallel_done(job);
+        }
+        //killall is waiting on this one. once it's off the list its group
+        //is only still ours if something else is in it
+        if(job->flags & JF_TEARDOWN)
+        {
+            teardown.left--;
+            pid = job->pid;
+            removejob(jobs, pid);
+            teardown_jobgone(pid);
+        }
+        else
+        {
+            removejob(jobs, job->pid);
+        }
+        if(teardown.active && teardown.left == 0)
+        {
+            teardown_reaped();
+        }
+    }
+}
+
+/*
+ * parallel_done - Account for a parallel worker that has just been
+ *    reaped. Called from sigchld_handler.
+ */
+void parallel_done(struct job_t *job)
+{
+    long ns;
+
+    ns = elapsed_ns(&job->start);
+    par.running--;
+    par.finished++;
+    par.total_ns += ns;
+    if (ns > par.max_ns)
+        par.max_ns = ns;
+}
+
+/*
+ * killall_expire - The timer wheel runs this when the killall timeout
+ * runs out. Tear down every EXISTING job
+ */
+
+void killall_expire(struct wtimer_t *t)
+{
+    //the jid loop that used to be here stopped at the first gap in the
+    //job IDs and only hit each job's leader; teardown_start walks the
+    //job table and signals whole process groups
+    teardown_start();
+    return;
+}
+
+/*
+ * job_expire - A job's timeout ran out: interrupt its process group,
+ *    and if an escalation was asked for, come back to SIGKILL it
+ */
+void job_expire(struct wtimer_t *t)
+{
+    struct jobtimer_t *jt = (struct jobtimer_t *)t;
+    struct job_t *job = getprocessid(jobs, jt->pgid);
+
+    /* the timer stays on the job either way; removejob frees it,
+       so the job is still there */
+    if (jt->killafter_ms < 0) {
+	job_kill(job, SIGKILL);
+    } else {
+	job_kill(job, SIGINT);
+	if (jt->killafter_ms > 0) {
+	    wt_add(t, jt->killafter_ms);
+	    jt->killafter_ms = -1;      /* next time round is the SIGKILL */
+	}
+    }
+}
+
+/* 
+ * sigint_handler - The kernel sends a SIGINT to the shell whenver the
+ *    user types ctrl-c at the keyboard.  Catch it and send it along
+ *    to the foreground job.  
+ */
+void sigint_handler(int sig) 
+{
+	//this is a relatively simplistic approach to handling a SIGINT call
+	//the first thing we need to do is acquire the foregroud pid and store it in 
+	//pidVal to be passed to kill with the SIGINT value after making sure the pid is 
+	//non-zero otherwise there would be no need for the kill to occur
+	//thus why the return lives outside of the for loop
+    pid_t pidVal = fgpid(jobs);
+    if(pidVal != 0)
+    {    
+        job_kill(getprocessid(jobs, pidVal), SIGINT);
+    }
+    //with no foreground job, ctrl-c during parallel cancels the whole run
+    else if(par.limit > 0)
+    {
+        par.interrupted = 1;
+    }
+    //and it stops output -f
+    else if(following)
+    {
+        following = 0;
+    }
+    return;
+}
+
+/*
+ * sigtstp_handler - The kernel sends a SIGTSTP to the shell whenever
+ *     the user types ctrl-z at the keyboard. Catch it and suspend the
+ *     foreground job by sending it a SIGTSTP.  
+ */
+void sigtstp_handler(int sig) 
+{
+	//again we use the pid_t struct to set the pid
+	//and set it using the foreground pid function
+    pid_t pidVal = fgpid(jobs);
+    //again we just make sure that the pidVal is not already 0'd before running
+    //kill processes
+    if(pidVal != 0){
+        //the job is marked stopped by sigchld_handler once the kernel
+        //reports it actually stopped, so waitfg keeps waiting until then
+        job_kill(getprocessid(jobs, pidVal), SIGTSTP);
+    }
+    //an added return after the if statement is useful to ensuring the cases where
+    //there are no foreground jobs to suspend so it can instead simply return 
+    //rather than attempting to kill non-existing processes
+    return;
+}
+
+/*********************
+ * End signal handlers
+ *********************/
+
+/***********************************************
+ * Helper routines that manipulate the job list
+ **********************************************/
+
+/* clearjob - Clear the entries in a job struct */
+void clearjob(struct job_t *job) {
+    job->pid = 0;
+    job->jid = 0;
+    job->state = UNDEF;
+    job->nprocs = 0;
+    job->nlive = 0;
+    job->termsig = 0;
+    job->flags = 0;
+    memset(&job->usage, 0, sizeof(job->usage));
+    job->deadline = NULL;
+    job->cmdlen = 0;
+    job->cmdline = NULL;
+    job->procs = NULL;
+    job->pidfds = NULL;
+}
+
+/* initjobs - Initialize the job list */
+void initjobs(struct joblist_t *jobs) {
+    memset(jobs, 0, sizeof(*jobs));
+    jobs->fg = -1;
+    growjobs(jobs);
+    growpids(jobs, 0);
+}
+
+/*
+ * growjobs - Double the job table. Only called from addjob, which
+ *    runs with the job signals blocked, so no handler can see the
+ *    table while it moves.
+ */
+int growjobs(struct joblist_t *jobs)
+{
+    int i, cap = jobs->cap ? jobs->cap * 2 : MAXJOBS;
+    struct job_t *slot;
+    int *freeslot;
+
+    if ((slot = realloc(jobs->slot, cap * sizeof(struct job_t))) == NULL)
+	return 0;
+    jobs->slot = slot;
+    if ((freeslot = realloc(jobs->freeslot, cap * sizeof(int))) == NULL)
+	return 0;
+    jobs->freeslot = freeslot;
+    /* hand out low slots first */
+    for (i = cap - 1; i >= jobs->cap; i--) {
+	clearjob(&jobs->slot[i]);
+	jobs->freeslot[jobs->nfree++] = i;
+    }
+    jobs->cap = cap;
+    return 1;
+}
+
+/*
+ * growpids - Rebuild the PID index so that it stays at most half
+ *    full with room for more new entries, dropping tombstones
+ */
+int growpids(struct joblist_t *jobs, int more)
+{
+    struct pident_t *pidtab;
+    int i, j, size = MAXJOBS * 2;
+
+    while (size < 2 * (jobs->npids + more) + 2)
+	size *= 2;
+    if ((pidtab = malloc(size * sizeof(struct pident_t))) == NULL)
+	return 0;
+    for (i = 0; i < size; i++)
+	pidtab[i].slot = -1;
+    free(jobs->pidtab);
+    jobs->pidtab = pidtab;
+    jobs->pidmask = size - 1;
+    jobs->tombs = 0;
+    jobs->npids = 0;
+    for (i = 0; i < jobs->cap; i++)
+	for (j = 0; j < jobs->slot[i].nprocs; j++)
+	    if (jobs->slot[i].procs[j] != 0)
+		pidinsert(jobs, jobs->slot[i].procs[j], i);
+    return 1;
+}
+
+/* pidprobe - Return the PID index position holding pid, or -1 */
+int pidprobe(struct joblist_t *jobs, pid_t pid)
+{
+    unsigned h = (unsigned)pid * 2654435761u;
+
+    for (h &= jobs->pidmask; jobs->pidtab[h].slot != -1;
+	 h = (h + 1) & jobs->pidmask)
+	if (jobs->pidtab[h].slot >= 0 && jobs->pidtab[h].pid == pid)
+	    return h;
+    return -1;
+}
+
+/* pidinsert - Index process pid as a member of the job in slot s */
+void pidinsert(struct joblist_t *jobs, pid_t pid, int s)
+{
+    unsigned h = (unsigned)pid * 2654435761u;
+
+    for (h &= jobs->pidmask; jobs->pidtab[h].slot >= 0;
+	 h = (h + 1) & jobs->pidmask)
+	;
+    if (jobs->pidtab[h].slot == PIDTOMB)
+	jobs->tombs--;
+    jobs->pidtab[h].pid = pid;
+    jobs->pidtab[h].slot = s;
+    jobs->npids++;
+}
+
+/* piddelete - Drop pid from the PID index */
+void piddelete(struct joblist_t *jobs, pid_t pid)
+{
+    int h;
+
+    if ((h = pidprobe(jobs, pid)) < 0)
+	return;
+    jobs->pidtab[h].slot = PIDTOMB;
+    jobs->tombs++;
+    jobs->npids--;
+}
+
+/* maxjid - Returns largest allocated job ID */
+int maxjid(struct joblist_t *jobs) 
+{
+    return jobs->maxjid;
+}
+
+/*
+ * nextfreejid - Pick the ID for a new job: one past the largest
+ *    ID in use, or the lowest free ID once that would pass MAXJID
+ */
+int nextfreejid(struct joblist_t *jobs)
+{
+    int w, jid;
+    uint64_t avail;
+
+    if (jobs->maxjid < MAXJID)
+	return jobs->maxjid + 1;
+    for (w = 0; w < JIDWORDS; w++) {
+	avail = ~jobs->jidmap[w];
+	if (w == 0)
+	    avail &= ~1ULL;	/* job ID 0 is never handed out */
+	if (avail != 0) {
+	    jid = w * 64 + __builtin_ctzll(avail);
+	    return jid <= MAXJID ? jid : 0;
+	}
+    }
+    return 0;
+}
+
+/* addjob - Add a single-process job to the job list */
+int addjob(struct joblist_t *jobs, pid_t pid, int state, char *cmdline) 
+{
+    return addjobprocs(jobs, &pid, 1, state, cmdline);
+}
+
+/*
+ * addjobprocs - Add a job made of the n processes in pids to the job
+ *    list. pids[0] leads the job: it is the job's PID and process
+ *    group, and stays indexed until the whole job is removed. Each
+ *    process gets a pidfd on the event loop, which is how it will be
+ *    reaped.
+ */
+int addjobprocs(struct joblist_t *jobs, pid_t *pids, int n, int state,
+		char *cmdline)
+{
+    struct job_t *job;
+    int i, s, jid, *jidslot, cap, len;
+    char *line;
+    pid_t *procs;
+    struct evsrc_t **pidfds;
+    
+    if (n < 1 || pids[0] < 1)
+	return 0;
+
+    if ((jid = nextfreejid(jobs)) == 0) {
+	printf("Tried to create too many jobs\n");
+	return 0;
+    }
+    if (jid >= jobs->jidcap) {
+	for (cap = jobs->jidcap ? jobs->jidcap : 64; jid >= cap; cap *= 2)
+	    ;
+	if ((jidslot = realloc(jobs->jidslot, cap * sizeof(int))) == NULL) {
+	    printf("Tried to create too many jobs\n");
+	    return 0;
+	}
+	jobs->jidslot = jidslot;
+	jobs->jidcap = cap;
+    }
+    /* keep the PID index at most half full, tombstones included */
+    if ((jobs->nfree == 0 && !growjobs(jobs)) ||
+	(2 * (jobs->npids + jobs->tombs + n) > jobs->pidmask + 1 &&
+	 !growpids(jobs, n))) {
+	printf("Tried to create too many jobs\n");
+	return 0;
+    }
+    len = strlen(cmdline);
+    if ((line = stralloc(&cmdarena, cmdline, len)) == NULL) {
+	printf("Tried to create too many jobs\n");
+	return 0;
+    }
+    if ((procs = blkalloc(&cmdarena, n * sizeof(pid_t))) == NULL) {
+	strfree(&cmdarena, line, len);
+	printf("Tried to create too many jobs\n");
+	return 0;
+    }
+    if ((pidfds = blkalloc(&cmdarena, n * sizeof(*pidfds))) == NULL) {
+	blkfree(&cmdarena, procs, n * sizeof(pid_t));
+	strfree(&cmdarena, line, len);
+	printf("Tried to create too many jobs\n");
+	return 0;
+    }
+
+    s = jobs->freeslot[--jobs->nfree];
+    job = &jobs->slot[s];
+    job->pid = pids[0];
+    job->state = state;
+    job->jid = jid;
+    job->nprocs = job->nlive = n;
+    job->termsig = 0;
+    job->flags = 0;
+    clock_gettime(CLOCK_MONOTONIC, &job->start);
+    memset(&job->usage, 0, sizeof(job->usage));
+    job->deadline = NULL;
+    job->cmdlen = len;
+    job->cmdline = line;
+    job->procs = procs;
+    job->pidfds = pidfds;
+    for (i = 0; i < n; i++) {
+	procs[i] = pids[i];
+	pidinsert(jobs, pids[i], s);
+	/* a child can't be reaped before it is on the list, so the
+	   pidfd is sure to be for our child */
+	if ((pidfds[i] = pidfd_watch(pids[i])) == NULL)
+	    untracked++;
+    }
+    jobs->jidslot[jid] = s;
+    jobs->jidmap[jid / 64] |= 1ULL << (jid % 64);
+    if (jid > jobs->maxjid)
+	jobs->maxjid = jid;
+    if (state == FG)
+	jobs->fg = s;
+    jobs->count++;
+    if(verbose){
+	printf("Added job [%d] %d %s\n", job->jid, job->pid, job->cmdline);
+    }
+    return 1;
+}
+
+/*
+ * procdone - Record that member pid of a job has terminated. Returns
+ *    the job if it still has live members, or NULL once the last one
+ *    is gone and the caller should remove the job.
+ */
+struct job_t *procdone(struct joblist_t *jobs, pid_t pid)
+{
+    struct job_t *job = getprocessid(jobs, pid);
+    int i;
+
+    if (job == NULL || --job->nlive == 0)
+	return NULL;
+    if (pid != job->pid) {
+	/* the leader stays indexed: its PID names the process group */
+	for (i = 0; i < job->nprocs; i++)
+	    if (job->procs[i] == pid)
+		job->procs[i] = 0;
+	piddelete(jobs, pid);
+    }
+    return job;
+}
+
+/*
+ * pidfd_watch - Open a pidfd for child pid and have proc_ready called
+ *    when it exits. Returns NULL if the kernel has no pidfds or we are
+ *    out of descriptors; sigchld_handler reaps such a child instead.
+ */
+struct evsrc_t *pidfd_watch(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    struct evsrc_t *src;
+    int fd;
+
+    /* pidfds are always close-on-exec */
+    if ((fd = syscall(SYS_pidfd_open, pid, 0)) < 0)
+	return NULL;
+    if ((src = ev_add(fd, EPOLLIN, proc_ready, (void *)(intptr_t)pid)) == NULL)
+	close(fd);
+    return src;
+#else
+    return NULL;
+#endif
+}
+
+/* pidfd_close - Stop watching the i'th process of job */
+void pidfd_close(struct job_t *job, int i)
+{
+    struct evsrc_t *src = job->pidfds[i];
+    int fd;
+
+    if (src == NULL)
+	return;
+    job->pidfds[i] = NULL;
+    /* out of epoll first: a child forked since could still hold the
+       pidfd open, and closing ours wouldn't remove it */
+    fd = src->fd;
+    ev_del(src);
+    close(fd);
+}
+
+/*
+ * job_kill - Send sig to job's process group. It goes through the
+ *    pidfd of a process that hasn't been reaped, so it can only reach
+ *    this job's group. Without one, or on a kernel that can't signal
+ *    a group through a pidfd, kill() is used. That is still safe
+ *    while the job is on the list, because an unreaped member keeps
+ *    the group ID from being reused. Returns what the call returned.
+ */
+int job_kill(struct job_t *job, int sig)
+{
+#ifdef SYS_pidfd_send_signal
+    static int nogroup;
+    int i;
+
+    for (i = 0; i < job->nprocs && !nogroup; i++) {
+	if (job->pidfds[i] == NULL)
+	    continue;
+	if (syscall(SYS_pidfd_send_signal, job->pidfds[i]->fd, sig, NULL,
+		    PIDFD_SIGNAL_PROCESS_GROUP) == 0)
+	    return 0;
+	if (errno == EINVAL)
+	    nogroup = 1;        /* before Linux 6.9 */
+	break;
+    }
+#endif
+    return kill(-job->pid, sig);
+}
+
+/* removejob - Delete the job that process pid belongs to from the job list */
+int removejob(struct joblist_t *jobs, pid_t pid) 
+{
+    struct job_t *job;
+    int i, s, jid, w;
+    uint64_t bits;
+
+    if (pid < 1 || (job = getprocessid(jobs, pid)) == NULL)
+	return 0;
+
+    s = job - jobs->slot;
+    jid = job->jid;
+    for (i = 0; i < job->nprocs; i++)
+	if (job->procs[i] != 0)
+	    piddelete(jobs, job->procs[i]);
+    jobs->jidmap[jid / 64] &= ~(1ULL << (jid % 64));
+    if (jobs->fg == s)
+	jobs->fg = -1;
+    for (i = 0; i < job->nprocs; i++)
+	pidfd_close(job, i);
+    strfree(&cmdarena, job->cmdline, job->cmdlen);
+    blkfree(&cmdarena, job->procs, job->nprocs * sizeof(pid_t));
+    blkfree(&cmdarena, job->pidfds, job->nprocs * sizeof(*job->pidfds));
+    if (job->deadline != NULL) {
+	wt_cancel(&job->deadline->t);
+	free(job->deadline);
+    }
+    clearjob(job);
+    jobs->freeslot[jobs->nfree++] = s;
+    jobs->count--;
+
+    /* find the new largest ID by scanning the bitmap downwards */
+    if (jid == jobs->maxjid) {
+	jobs->maxjid = 0;
+	for (w = jid / 64; w >= 0; w--) {
+	    if ((bits = jobs->jidmap[w]) != 0) {
+		jobs->maxjid = w * 64 + 63 - __builtin_clzll(bits);
+		break;
+	    }
+	}
+    }
+    return 1;
+}
+
+/* setjobstate - Change a job's state, keeping the FG job cached */
+void setjobstate(struct joblist_t *jobs, struct job_t *job, int state)
+{
+    int s = job - jobs->slot;
+
+    if (jobs->fg == s && state != FG)
+	jobs->fg = -1;
+    if (state == FG)
+	jobs->fg = s;
+    job->state = state;
+}
+
+/* fgpid - Return PID of current foreground job, 0 if no such job */
+pid_t fgpid(struct joblist_t *jobs) {
+    if (jobs->fg < 0)
+	return 0;
+    return jobs->slot[jobs->fg].pid;
+}
+
+/* getprocessid  - Find a job (by the PID of any of its processes) on the job list */
+struct job_t *getprocessid(struct joblist_t *jobs, pid_t pid) {
+    int h;
+
+    if (pid < 1 || (h = pidprobe(jobs, pid)) < 0)
+	return NULL;
+    return &jobs->slot[jobs->pidtab[h].slot];
+}
+
+/* getjobid  - Find a job (by JID) on the job list */
+struct job_t *getjobid(struct joblist_t *jobs, int jid) 
+{
+    if (jid < 1 || jid > jobs->maxjid ||
+	!(jobs->jidmap[jid / 64] & (1ULL << (jid % 64))))
+	return NULL;
+    return &jobs->slot[jobs->jidslot[jid]];
+}
+
+/* get_jid_from_pid - Map process ID to job ID */
+int get_jid_from_pid(pid_t pid) 
+{
+    struct job_t *job = getprocessid(jobs, pid);
+
+    return job ? job->jid : 0;
+}
+
+/* showjobs - Print the job list in job ID order */
+void showjobs(struct joblist_t *jobs) 
+{
+    struct job_t *job;
+    uint64_t bits;
+    int w;
+    
+    for (w = 0; w <= jobs->maxjid / 64; w++) {
+	for (bits = jobs->jidmap[w]; bits != 0; bits &= bits - 1) {
+	    job = &jobs->slot[jobs->jidslot[w * 64 + __builtin_ctzll(bits)]];
+	    printf("[%d] (%d) ", job->jid, job->pid);
+	    switch (job->state) {
+		case BG: 
+		    printf("Running ");
+		    break;
+		case FG: 
+		    printf("Foreground ");
+		    break;
+		case ST: 
+		    printf("Stopped ");
+		    break;
+	    default:
+		    printf("showjobs: Internal error: job[%d].state=%d ", 
+			   job->jid, job->state);
+	    }
+	    printf("%s", job->cmdline);
+	}
+    }
+}
+/*
+ * showjobs_long - Print the job list like showjobs, each job followed
+ *    by the resources it has used so far: finished processes are
+ *    counted from wait4, live ones are read from /proc
+ */
+void showjobs_long(struct joblist_t *jobs)
+{
+    struct job_t *job;
+    struct usage_t u;
+    uint64_t bits;
+    int w, i;
+    
+    for (w = 0; w <= jobs->maxjid / 64; w++) {
+	for (bits = jobs->jidmap[w]; bits != 0; bits &= bits - 1) {
+	    job = &jobs->slot[jobs->jidslot[w * 64 + __builtin_ctzll(bits)]];
+	    u = job->usage;
+	    for (i = 0; i < job->nprocs; i++)
+		if (job->procs[i] != 0)
+		    procusage(job->procs[i], &u);
+	    fmtusage(sbuf, sizeof(sbuf), &u, elapsed_ns(&job->start));
+	    printf("[%d] (%d) %s %s    %s\n", job->jid, job->pid,
+		   job->state == ST ? "Stopped" :
+		   job->state == FG ? "Foreground" : "Running",
+		   job->cmdline, sbuf);
+	}
+    }
+}
+
+/*
+ * The job records only point at their command lines and PID lists,
+ * so the fields scanned by the job helpers stay packed together. The
+ * variable-sized parts live in a size-class arena: each block is
+ * rounded up to the next power of two from STRMIN to MAXLINE and
+ * freed blocks are recycled through a per-class free list. The rare
+ * block bigger than MAXLINE (a very long command line) comes straight
+ * from malloc; sigchld_handler runs from the event loop, so removejob
+ * may free it.
+ */
+
+/* strclass - Return the arena size class for a block of size bytes */
+int strclass(size_t size)
+{
+    int c = 0;
+
+    while (c < STRCLASSES - 1 && ((size_t)STRMIN << c) < size)
+	c++;
+    return c;
+}
+
+/* blkalloc - Allocate a block of size bytes from the arena */
+void *blkalloc(struct arena_t *a, size_t bytes)
+{
+    int c = strclass(bytes);
+    size_t size = (size_t)STRMIN << c;
+    char *p;
+
+    if (bytes > MAXLINE)
+	return malloc(bytes);
+    if ((p = a->freelist[c]) != NULL) {
+	memcpy(&a->freelist[c], p, sizeof(char *));
+    } else {
+	if (a->left < size) {
+	    if ((a->chunk = malloc(STRCHUNK)) == NULL)
+		return NULL;
+	    a->left = STRCHUNK;
+	}
+	p = a->chunk;
+	a->chunk += size;
+	a->left -= size;
+    }
+    return p;
+}
+
+/* blkfree - Return a block from blkalloc to its size class */
+void blkfree(struct arena_t *a, void *blk, size_t bytes)
+{
+    int c;
+
+    if (blk == NULL)
+	return;
+    if (bytes > MAXLINE) {
+	free(blk);
+	return;
+    }
+    c = strclass(bytes);
+    memcpy(blk, &a->freelist[c], sizeof(char *));
+    a->freelist[c] = blk;
+}
+
+/* stralloc - Copy the len-byte string str into the arena */
+char *stralloc(struct arena_t *a, const char *str, int len)
+{
+    char *p;
+
+    if ((p = blkalloc(a, len + 1)) != NULL)
+	memcpy(p, str, len + 1);
+    return p;
+}
+
+/* strfree - Return a string from stralloc to its size class */
+void strfree(struct arena_t *a, char *str, int len)
+{
+    blkfree(a, str, len + 1);
+}
+
+/*
+ * Every process is reaped with wait4, and its rusage is folded into
+ * its job's usage_t. CPU times and context switches add up across a
+ * pipeline's stages; maxrss is the largest of them, since the stages
+ * aren't resident one after another.
+ */
+
+/* addusage - Add what one reaped process used to a job's totals */
+void addusage(struct usage_t *u, const struct rusage *ru)
+{
+    u->utime_us += ru->ru_utime.tv_sec * 1000000L + ru->ru_utime.tv_usec;
+    u->stime_us += ru->ru_stime.tv_sec * 1000000L + ru->ru_stime.tv_usec;
+    if (ru->ru_maxrss > u->maxrss)
+	u->maxrss = ru->ru_maxrss;
+    u->nvcsw += ru->ru_nvcsw;
+    u->nivcsw += ru->ru_nivcsw;
+}
+
+/*
+ * procusage - Add what the live process pid has used so far to u,
+ *    read from /proc/<pid>/stat and /proc/<pid>/status
+ */
+void procusage(pid_t pid, struct usage_t *u)
+{
+    static long tick;
+    char path[64], buf[1024], *p;
+    unsigned long ut, st;
+    long v;
+    FILE *fp;
+    int i;
+
+    if (tick == 0)
+	tick = sysconf(_SC_CLK_TCK);
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    if ((fp = fopen(path, "r")) == NULL)
+	return;
+    /* the command name may hold spaces; fields resume after its ')' */
+    if (fgets(buf, sizeof(buf), fp) != NULL && (p = strrchr(buf, ')')) != NULL) {
+	for (i = 0; i < 12 && p != NULL; i++)
+	    p = strchr(p + 1, ' ');
+	if (p != NULL && sscanf(p, "%lu %lu", &ut, &st) == 2) {
+	    u->utime_us += ut * (1000000L / tick);
+	    u->stime_us += st * (1000000L / tick);
+	}
+    }
+    fclose(fp);
+
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    if ((fp = fopen(path, "r")) == NULL)
+	return;
+    while (fgets(buf, sizeof(buf), fp) != NULL) {
+	if (sscanf(buf, "VmHWM: %ld", &v) == 1 && v > u->maxrss)
+	    u->maxrss = v;
+	else if (sscanf(buf, "voluntary_ctxt_switches: %ld", &v) == 1)
+	    u->nvcsw += v;
+	else if (sscanf(buf, "nonvoluntary_ctxt_switches: %ld", &v) == 1)
+	    u->nivcsw += v;
+    }
+    fclose(fp);
+}
+
+/* elapsed_ns - Return the nanoseconds since the CLOCK_MONOTONIC time since */
+long elapsed_ns(const struct timespec *since)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000000000L
+	+ (now.tv_nsec - since->tv_nsec);
+}
+
+/* fmtusage - Format a job's usage and wall-clock time into buf */
+void fmtusage(char *buf, size_t size, const struct usage_t *u, long wall_ns)
+{
+    snprintf(buf, size, "real %.3fs user %.3fs sys %.3fs maxrss %ldK csw %ld/%ld",
+	     wall_ns / 1e9, u->utime_us / 1e6, u->stime_us / 1e6,
+	     u->maxrss, u->nvcsw, u->nivcsw);
+}
+/******************************
+ * end job list helper routines
+ ******************************/
+
+
+/*********************************
+ * Helper routines for the event loop
+ *
+ * Everything the shell waits for is a descriptor on one epoll
+ * instance: the job signals through a signalfd, and the shell's
+ * input. ev_wait sleeps until some of them are ready and calls
+ * their callbacks. Waits nest (a foreground job started from a
+ * script line waits inside that line's eval), so removed sources
+ * are only freed once the outermost ev_wait is done with its batch.
+ *********************************/
+
+/* ev_init - Create the epoll instance and watch the job signals */
+void ev_init(void)
+{
+    if ((evfd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+	unix_error("epoll_create1 error");
+    if ((sigfd = signalfd(-1, &jobsigs, SFD_NONBLOCK | SFD_CLOEXEC)) < 0)
+	unix_error("signalfd error");
+    if (ev_add(sigfd, EPOLLIN, sig_ready, NULL) == NULL)
+	unix_error("epoll_ctl error");
+}
+
+/*
+ * ev_add - Call fn whenever fd is ready for events (EPOLLIN, ...).
+ *    Returns the new source, or NULL with errno set, e.g. EPERM for
+ *    a regular file, which epoll can't watch.
+ */
+struct evsrc_t *ev_add(int fd, int events, void (*fn)(struct evsrc_t *),
+		       void *arg)
+{
+    struct epoll_event ev;
+    struct evsrc_t *src;
+
+    if ((src = malloc(sizeof(*src))) == NULL)
+	return NULL;
+    src->fd = fd;
+    src->fn = fn;
+    src->arg = arg;
+    src->next = NULL;
+    ev.events = events;
+    ev.data.ptr = src;
+    if (epoll_ctl(evfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+	free(src);
+	return NULL;
+    }
+    return src;
+}
+
+/* ev_mod - Change the events a source is watched for */
+int ev_mod(struct evsrc_t *src, int events)
+{
+    struct epoll_event ev;
+
+    ev.events = events;
+    ev.data.ptr = src;
+    return epoll_ctl(evfd, EPOLL_CTL_MOD, src->fd, &ev);
+}
+
+/* ev_del - Stop watching a source. The caller still owns its fd. */
+void ev_del(struct evsrc_t *src)
+{
+    if (src == NULL || src->fd < 0)
+	return;
+    epoll_ctl(evfd, EPOLL_CTL_DEL, src->fd, NULL);
+    src->fd = -1;
+    src->next = evdead;
+    evdead = src;
+}
+
+/*
+ * ev_wait - Wait up to timeout ms (-1: forever) for ready sources and
+ *    run their callbacks. Returns the number of sources that were ready.
+ */
+int ev_wait(int timeout)
+{
+    struct epoll_event evs[64];
+    struct evsrc_t *src;
+    int i, n;
+
+    if ((n = epoll_wait(evfd, evs, 64, timeout)) < 0) {
+	if (errno != EINTR)
+	    unix_error("epoll_wait error");
+	return 0;
+    }
+    evdepth++;
+    for (i = 0; i < n; i++) {
+	src = evs[i].data.ptr;
+	if (src->fd >= 0)
+	    src->fn(src);
+    }
+    if (--evdepth == 0) {
+	while ((src = evdead) != NULL) {
+	    evdead = src->next;
+	    free(src);
+	}
+    }
+    return n;
+}
+
+/*
+ * sig_ready - Drain the signalfd and run the handlers. A burst of
+ *    child exits is read in one go and reaped by a single
+ *    sigchld_handler call.
+ */
+void sig_ready(struct evsrc_t *src)
+{
+    struct signalfd_siginfo si[64];
+    ssize_t n;
+    int i, reap = 0;
+
+    if (trace.on)
+	sigread_ns = mono_ns();
+    while ((n = read(src->fd, si, sizeof(si))) > 0) {
+	for (i = 0; i < n / (ssize_t)sizeof(si[0]); i++) {
+	    switch (si[i].ssi_signo) {
+	    case SIGCHLD:
+		reap = 1;
+		break;
+	    case SIGINT:
+		sigint_handler(SIGINT);
+		break;
+	    case SIGTSTP:
+		sigtstp_handler(SIGTSTP);
+		break;
+	    }
+	}
+    }
+    if (reap)
+	sigchld_handler(SIGCHLD);
+}
+
+/*
+ * proc_ready - A child's pidfd became readable: it has exited, and is
+ *    reaped by PID, which the pidfd keeps from being reused
+ */
+void proc_ready(struct evsrc_t *src)
+{
+    pid_t pid = (pid_t)(intptr_t)src->arg;
+    struct rusage ru;
+    int status;
+
+    if (trace.on)
+	sigread_ns = mono_ns();
+    if (wait4(pid, &status, WNOHANG, &ru) == pid)
+	child_reaped(pid, status, &ru);
+}
+
+/*
+ * input_init - Read lines from fd through the event loop. If epoll
+ *    can't watch fd (a regular file, /dev/null) it is simply read,
+ *    since reading it won't block for long.
+ */
+void input_init(struct input_t *in, int fd)
+{
+    memset(in, 0, sizeof(*in));
+    in->fd = fd;
+    in->tty = isatty(fd);
+    in->size = INBUF;
+    if ((in->buf = malloc(in->size + 2)) == NULL)
+	unix_error("malloc error");
+    in->src = ev_add(fd, EPOLLIN | EPOLLONESHOT, input_ready, in);
+    if (in->tty && tcgetattr(fd, &edit.saved) == 0) {
+	edit.on = 1;
+	atexit(edit_reset);
+    }
+}
+
+/*
+ * input_ready - The input became readable. The source is one-shot so
+ *    that input waiting behind a foreground job doesn't keep waking
+ *    the loop; input_line re-arms it after reading.
+ */
+void input_ready(struct evsrc_t *src)
+{
+    ((struct input_t *)src->arg)->ready = 1;
+}
+
+/*
+ * input_line - Return the next line of input, including its newline,
+ *    and set *len to its length, or return NULL at end of file. The
+ *    line is not copied: it is NUL-terminated where it lies in the
+ *    buffer and stays valid until the next call. Lines can be any
+ *    length; the buffer grows to hold the longest one.
+ */
+char *input_line(struct input_t *in, size_t *len)
+{
+    char *line, *nl;
+    size_t scanned = 0, n;
+    ssize_t got;
+
+    if (in->held != NULL) {
+	*in->held = in->saved;
+	in->held = NULL;
+    }
+    for (;;) {
+	line = in->buf + in->start;
+	n = in->end - in->start;
+	nl = memchr(line + scanned, '\n', n - scanned);
+	if (nl != NULL || (in->eof && n > 0)) {
+	    if (nl != NULL) {
+		n = nl - line + 1;
+	    } else {
+		line[n++] = '\n';       /* unterminated last line */
+		in->end++;
+	    }
+	    in->start += n;
+	    in->held = line + n;
+	    in->saved = *in->held;
+	    *in->held = '\0';
+	    *len = n;
+	    return line;
+	}
+	if (in->eof)
+	    return NULL;
+	scanned = n;
+	if (n == 0) {
+	    in->start = in->end = 0;
+	} else if (in->end == in->size) {
+	    if (in->start > 0) {
+		memmove(in->buf, line, n);
+	    } else {
+		/* the line fills the buffer: double it */
+		if ((line = realloc(in->buf, 2 * in->size + 2)) == NULL)
+		    unix_error("realloc error");
+		in->buf = line;
+		in->size *= 2;
+	    }
+	    in->start = 0;
+	    in->end = n;
+	}
+	if ((got = input_read(in, in->buf + in->end, in->size - in->end)) > 0)
+	    in->end += got;
+    }
+}
+
+/*
+ * input_rest - Return the rest of the input, up to end of file, in a
+ *    malloc'd buffer of *size bytes the caller frees
+ */
+char *input_rest(struct input_t *in, size_t *size)
+{
+    size_t n, cap;
+    ssize_t got;
+    char *buf;
+
+    if (in->held != NULL) {
+	*in->held = in->saved;
+	in->held = NULL;
+    }
+    n = in->end - in->start;
+    cap = n < INBUF ? INBUF : 2 * n;
+    if ((buf = malloc(cap)) == NULL)
+	unix_error("malloc error");
+    memcpy(buf, in->buf + in->start, n);
+    in->start = in->end = 0;
+    while (!in->eof) {
+	if (n == cap && (buf = realloc(buf, cap *= 2)) == NULL)
+	    unix_error("realloc error");
+	if ((got = input_read(in, buf + n, cap - n)) > 0)
+	    n += got;
+    }
+    *size = n;
+    return buf;
+}
+
+/*
+ * input_read - Read up to room bytes of input into dst, handling job
+ *    events while waiting for it. Sets in->eof and returns 0 at end of
+ *    file, or returns -1 if the read was interrupted. A terminal's
+ *    input goes through the line editor.
+ */
+ssize_t input_read(struct input_t *in, char *dst, size_t room)
+{
+    if (in->tty && edit.on)
+	return edit_read(in, dst, room);
+    return input_fetch(in, dst, room);
+}
+
+/*
+ * input_fetch - input_read without the line editor.
+ *
+ *    Piped input with no jobs to watch takes a fast path: nothing can
+ *    need the event loop, so the read is made directly, skipping the
+ *    epoll_wait and the re-arming of the one-shot source around it.
+ */
+ssize_t input_fetch(struct input_t *in, char *dst, size_t room)
+{
+    ssize_t n;
+    int direct;
+
+    for (;;) {
+	direct = in->src == NULL || in->ready ||
+	    (!in->tty && jobs->count == 0);
+	if (direct)
+	    break;
+	ev_wait(-1);
+	fflush(stdout);         /* job notices printed while idle */
+    }
+    n = read(in->fd, dst, room);
+    if (in->src != NULL && in->ready) {
+	in->ready = 0;
+	ev_mod(in->src, EPOLLIN | EPOLLONESHOT);
+    }
+    if (n < 0 && errno != EINTR && errno != EAGAIN)
+	app_error("read error");
+    if (n == 0)
+	in->eof = 1;
+    return n;
+}
+
+/*
+ * edit_read - input_read for a terminal. Keys are read with the
+ *    terminal out of canonical mode and edited into a line on the
+ *    screen, which input_line gets once return is pressed. Tab
+ *    completes a command name from the PATH catalog. The terminal is
+ *    only in our mode while a line is being typed, so jobs always get
+ *    it back as it was.
+ */
+ssize_t edit_read(struct input_t *in, char *dst, size_t room)
+{
+    struct termios t;
+    ssize_t n;
+
+    if (edit.out == edit.len) {         /* start a new line */
+	edit.len = edit.out = 0;
+	t = edit.saved;
+	t.c_lflag &= ~(ICANON | ECHO);
+	t.c_cc[VMIN] = 1;
+	t.c_cc[VTIME] = 0;
+	tcsetattr(in->fd, TCSANOW, &t);
+	edit.raw = 1;
+	while (edit.len == 0 || edit.line[edit.len - 1] != '\n') {
+	    if (edit.key == edit.nkeys) {
+		fflush(stdout);
+		if ((n = input_fetch(in, edit.keys, sizeof(edit.keys))) < 0)
+		    continue;
+		edit.key = 0;
+		edit.nkeys = n;
+		if (n == 0)
+		    break;              /* hung up */
+	    }
+	    if (edit_key(edit.keys[edit.key++]) < 0) {
+		in->eof = 1;
+		break;
+	    }
+	}
+	edit_reset();
+	if (in->eof)
+	    return 0;
+    }
+    n = edit.len - edit.out < room ? edit.len - edit.out : room;
+    memcpy(dst, edit.line + edit.out, n);
+    edit.out += n;
+    return n;
+}
+
+/*
+ * edit_key - Act on one key typed at the terminal. Returns -1 for
+ *    ctrl-d on an empty line, else 0.
+ */
+int edit_key(char c)
+{
+    size_t n;
+
+    if (edit.esc == 1) {                /* ESC [ or ESC O starts a sequence */
+	edit.esc = (c == '[' || c == 'O') ? 2 : 0;
+	return 0;
+    }
+    if (edit.esc == 2) {                /* which the cursor keys aren't handled */
+	if (c >= 0x40 && c <= 0x7e)
+	    edit.esc = 0;
+	return 0;
+    }
+    switch (c) {
+    case '\r':
+    case '\n':
+	edit_insert("\n", 1);
+	break;
+    case 4:                             /* ctrl-d */
+	if (edit.len == 0)
+	    return -1;
+	break;
+    case '\b':
+    case 0x7f:
+	edit_erase(1);
+	break;
+    case 0x15:                          /* ctrl-u: the whole line */
+	edit_erase(edit.len);
+	break;
+    case 0x17:                          /* ctrl-w: the last word */
+	for (n = edit.len; n > 0 && isspace((unsigned char)edit.line[n - 1]); n--)
+	    ;
+	while (n > 0 && !isspace((unsigned char)edit.line[n - 1]))
+	    n--;
+	edit_erase(edit.len - n);
+	break;
+    case '\t':
+	edit_complete();
+	break;
+    case 033:
+	edit.esc = 1;
+	break;
+    default:
+	if ((unsigned char)c >= ' ')
+	    edit_insert(&c, 1);
+	break;
+    }
+    return 0;
+}
+
+/* edit_insert - Add n bytes to the line and show them */
+void edit_insert(const char *s, size_t n)
+{
+    if (edit.len + n > edit.cap) {
+	edit.cap = edit.cap ? 2 * edit.cap + n : MAXLINE;
+	if ((edit.line = realloc(edit.line, edit.cap)) == NULL)
+	    unix_error("edit_insert: realloc");
+    }
+    memcpy(edit.line + edit.len, s, n);
+    edit.len += n;
+    edit_echo(s, n);
+}
+
+/*
+ * edit_erase - Take n characters (not bytes: a UTF-8 sequence goes as
+ *    one) off the end of the line, and off the screen
+ */
+void edit_erase(size_t n)
+{
+    while (n-- > 0 && edit.len > 0) {
+	while (--edit.len > 0 && (edit.line[edit.len] & 0xc0) == 0x80)
+	    ;
+	edit_echo("\b \b", 3);
+    }
+}
+
+/* edit_echo - Show n bytes on the terminal, ours to echo now */
+void edit_echo(const char *s, size_t n)
+{
+    ssize_t got;
+
+    while (n > 0 && ((got = write(STDOUT_FILENO, s, n)) > 0 || errno == EINTR)) {
+	if (got > 0) {
+	    s += got;
+	    n -= got;
+	}
+    }
+}
+
+/*
+ * edit_complete - Complete the command name being typed: as far as all
+ *    the candidates agree, with a space after it if there is only one.
+ *    When that adds nothing, the candidates are listed and the line is
+ *    drawn again below them.
+ */
+void edit_complete(void)
+{
+    const char **names = NULL;
+    size_t start, i, len, common;
+    int n, j;
+
+    for (start = edit.len; start > 0; start--)
+	if (isspace((unsigned char)edit.line[start - 1]) ||
+	    strchr("|;&", edit.line[start - 1]) != NULL)
+	    break;
+    for (i = start; i > 0 && isspace((unsigned char)edit.line[i - 1]); i--)
+	;
+    /* only the first word of a command is a command name */
+    len = edit.len - start;
+    if ((i > 0 && strchr("|;&", edit.line[i - 1]) == NULL) ||
+	memchr(edit.line + start, '/', len) != NULL ||
+	(n = path_complete(edit.line + start, len, &names)) == 0) {
+	free(names);
+	edit_echo("\a", 1);
+	return;
+    }
+    common = strlen(names[0]);
+    for (j = 1; j < n; j++)
+	for (i = len; i < common; i++)
+	    if (names[j][i] != names[0][i]) {
+		common = i;
+		break;
+	    }
+    if (common > len)
+	edit_insert(names[0] + len, common - len);
+    if (n == 1) {
+	edit_insert(" ", 1);
+    } else if (common == len) {
+	printf("\n");
+	if (n > MAXCOMPLETE)
+	    printf("%d commands", n);
+	else
+	    for (j = 0; j < n; j++)
+		printf("%s%s", j ? "  " : "", names[j]);
+	printf("\n%s%.*s", edit.prompt, (int)edit.len, edit.line);
+	fflush(stdout);
+    }
+    free(names);
+}
+
+/* edit_reset - Give the terminal back its own settings */
+void edit_reset(void)
+{
+    if (edit.raw) {
+	tcsetattr(input.fd, TCSANOW, &edit.saved);
+	edit.raw = 0;
+    }
+}
+/*********************************
+ * end event loop helper routines
+ *********************************/
+
+
+/*************************************
+ * Helper routines for the timer wheel
+ *
+ * Timers live on a hierarchical wheel of WHEELLEVELS levels with
+ * WHEELSLOTS slots each. Level 0 holds the timers due within the next
+ * 64 ticks, one slot per tick; each level up covers 64 times the span
+ * of the one below. Every 64 ticks the next slot of the level above
+ * is cascaded down, so adding, cancelling and expiring a timer are all
+ * O(1) however many there are. The wheel is driven by a timerfd that
+ * only ticks while some timer is pending.
+ *************************************/
+
+/* wheel_init - Create the timerfd and hook it into the event loop */
+void wheel_init(void)
+{
+    if ((wheel.tfd = timerfd_create(CLOCK_MONOTONIC,
+				    TFD_NONBLOCK | TFD_CLOEXEC)) < 0)
+	unix_error("timerfd_create error");
+    if (ev_add(wheel.tfd, EPOLLIN, wheel_ready, NULL) == NULL)
+	unix_error("epoll_ctl error");
+    clock_gettime(CLOCK_MONOTONIC, &wheel.base);
+}
+
+/* wheel_clock - Return the current time in ticks */
+uint64_t wheel_clock(void)
+{
+    return elapsed_ns(&wheel.base) / (TICKMS * 1000000L);
+}
+
+/* wheel_arm - Start or stop the tick */
+void wheel_arm(int on)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    if (on) {
+	its.it_interval.tv_nsec = TICKMS * 1000000L;
+	its.it_value = its.it_interval;
+    }
+    timerfd_settime(wheel.tfd, 0, &its, NULL);
+}
+
+/* wt_insert - Put t in the slot matching its distance from now */
+void wt_insert(struct wtimer_t *t)
+{
+    struct wtimer_t **slot;
+    uint64_t delta;
+    int level = 0;
+
+    if (t->expires < wheel.now)
+	t->expires = wheel.now;
+    delta = t->expires - wheel.now;
+    while (level < WHEELLEVELS - 1 &&
+	   delta >= (uint64_t)1 << (WHEELBITS * (level + 1)))
+	level++;
+    if (delta >= (uint64_t)1 << (WHEELBITS * WHEELLEVELS))
+	/* too far out: park it at the top and re-file it when it cascades */
+	slot = &wheel.slot[level][(wheel.now >> (WHEELBITS * level))
+				  & (WHEELSLOTS - 1)];
+    else
+	slot = &wheel.slot[level][(t->expires >> (WHEELBITS * level))
+				  & (WHEELSLOTS - 1)];
+    if ((t->next = *slot) != NULL)
+	t->next->pprev = &t->next;
+    t->pprev = slot;
+    *slot = t;
+}
+
+/* wt_add - Run t->fn in ms milliseconds; t must not be pending */
+void wt_add(struct wtimer_t *t, long ms)
+{
+    if (wheel.pending == 0)
+	wheel.now = wheel_clock();      /* the wheel stands still when idle */
+    t->expires = wheel_clock() + (ms + TICKMS - 1) / TICKMS;
+    /* the slot for the current tick has already been run */
+    if (t->expires <= wheel.now)
+	t->expires = wheel.now + 1;
+    wt_insert(t);
+    if (wheel.pending++ == 0)
+	wheel_arm(1);
+}
+
+/* wt_cancel - Take t off the wheel if it is pending */
+void wt_cancel(struct wtimer_t *t)
+{
+    if (t->pprev == NULL)
+	return;
+    if ((*t->pprev = t->next) != NULL)
+	t->next->pprev = t->pprev;
+    t->pprev = NULL;
+    if (--wheel.pending == 0)
+	wheel_arm(0);
+}
+
+/*
+ * wheel_ready - The timerfd ticked. Catch the wheel up with the clock,
+ *    one tick at a time, cascading and running whatever expires.
+ */
+void wheel_ready(struct evsrc_t *src)
+{
+    struct wtimer_t *t, *list;
+    uint64_t ticks, target = wheel_clock();
+    int level;
+
+    while (read(src->fd, &ticks, sizeof(ticks)) > 0)
+	;
+    while (wheel.now < target && wheel.pending > 0) {
+	wheel.now++;
+	/* refill the levels below from the next slot above */
+	for (level = 1; level < WHEELLEVELS; level++) {
+	    if ((wheel.now >> (WHEELBITS * (level - 1))) & (WHEELSLOTS - 1))
+		break;
+	    list = wheel.slot[level][(wheel.now >> (WHEELBITS * level))
+				     & (WHEELSLOTS - 1)];
+	    wheel.slot[level][(wheel.now >> (WHEELBITS * level))
+			      & (WHEELSLOTS - 1)] = NULL;
+	    while ((t = list) != NULL) {
+		list = t->next;
+		wt_insert(t);
+	    }
+	}
+	/* a callback may add or cancel timers, so pop one at a time */
+	while ((t = wheel.slot[0][wheel.now & (WHEELSLOTS - 1)]) != NULL) {
+	    wt_cancel(t);
+	    t->fn(t);
+	}
+    }
+    if (wheel.pending == 0)
+	wheel.now = target;
+}
+/*************************************
+ * end timer wheel helper routines
+ *************************************/
+
+
+/*************************************************
+ * Helper routines for lifecycle tracing
+ *
+ * Events are stamped with CLOCK_MONOTONIC and kept in a ring of the
+ * last TRACESIZE; per-type totals and a histogram of durations are
+ * kept for every event ever recorded, so trace stats stays accurate
+ * after the ring wraps. Each event carries the duration of the phase
+ * it ends:
+ *     parse    tokenizing the line
+ *     fork     fork() returning in the shell (posix_spawn with -s)
+ *     exec     fork returning until the child exec'd
+ *     stop     reading the signalfd until the stop was handled
+ *     cont     sending SIGCONT
+ *     reap     reading the signalfd until that child was reaped
+ *     builtin  running the builtin
+ * Callers only read the clock when trace.on is set.
+ *************************************************/
+
+/* mono_ns - Return CLOCK_MONOTONIC in nanoseconds */
+long mono_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/* trace_event - Record an event that ended a phase of dur_ns */
+void trace_event(int type, pid_t pid, int jid, long dur_ns)
+{
+    struct tevent_t *e = &trace.ring[trace.head % TRACESIZE];
+    struct phase_t *ph = &trace.phase[type];
+    long us = dur_ns / 1000;
+    int b = 0;
+
+    if (trace.out != NULL && trace.head - trace.flushed == TRACESIZE)
+	trace_flush();          /* about to overwrite unwritten events */
+    e->ns = mono_ns();
+    e->dur_ns = dur_ns;
+    e->pid = pid;
+    e->jid = jid;
+    e->type = type;
+    trace.head++;
+
+    /* bucket 0 is under 1us, bucket b is [2^(b-1), 2^b) us */
+    if (us > 0)
+	b = 64 - __builtin_clzl(us);
+    if (b >= TRACEBUCKETS)
+	b = TRACEBUCKETS - 1;
+    ph->hist[b]++;
+    ph->n++;
+    ph->total_ns += dur_ns;
+    if (dur_ns > ph->max_ns)
+	ph->max_ns = dur_ns;
+}
+
+/*
+ * trace_write - Write events from..to-1 to fp as JSON lines, skipping
+ *    any that have already left the ring
+ */
+void trace_write(FILE *fp, long from, long to)
+{
+    struct tevent_t *e;
+
+    if (from < trace.head - TRACESIZE)
+	from = trace.head - TRACESIZE;
+    if (from < 0)
+	from = 0;
+    for (; from < to; from++) {
+	e = &trace.ring[from % TRACESIZE];
+	fprintf(fp, "{\"ns\":%ld,\"event\":\"%s\",\"pid\":%d,\"jid\":%d,"
+		"\"dur_ns\":%ld}\n", e->ns, tenames[e->type], (int)e->pid,
+		e->jid, e->dur_ns);
+    }
+    fflush(fp);
+}
+
+/* trace_flush - Append the events not written yet to the trace file */
+void trace_flush(void)
+{
+    if (trace.out == NULL)
+	return;
+    trace_write(trace.out, trace.flushed, trace.head);
+    trace.flushed = trace.head;
+}
+
+/* trace_stats - Print per-phase latencies and histograms */
+void trace_stats(void)
+{
+    struct phase_t *ph;
+    char label[32];
+    long most;
+    int t, b, lo, bar;
+
+    printf("trace: %ld events, %s\n", trace.head, trace.on ? "on" : "off");
+    printf("%-8s %8s %10s %10s\n", "phase", "count", "avg us", "max us");
+    for (t = 0; t < TE_NTYPES; t++) {
+	ph = &trace.phase[t];
+	if (ph->n > 0)
+	    printf("%-8s %8ld %10.1f %10.1f\n", tenames[t], ph->n,
+		   ph->total_ns / (double)ph->n / 1e3, ph->max_ns / 1e3);
+    }
+    for (t = 0; t < TE_NTYPES; t++) {
+	ph = &trace.phase[t];
+	if (ph->n == 0)
+	    continue;
+	printf("%s:\n", tenames[t]);
+	for (most = 0, b = 0; b < TRACEBUCKETS; b++)
+	    if (ph->hist[b] > most)
+		most = ph->hist[b];
+	for (b = 0; b < TRACEBUCKETS; b++) {
+	    if (ph->hist[b] == 0)
+		continue;
+	    lo = b ? 1 << (b - 1) : 0;
+	    if (b == TRACEBUCKETS - 1)
+		snprintf(label, sizeof(label), "%dus+", lo);
+	    else
+		snprintf(label, sizeof(label), "%d-%dus", lo, 1 << b);
+	    bar = (ph->hist[b] * 40 + most - 1) / most;
+	    printf("  %16s %8ld %.*s\n", label, ph->hist[b], bar,
+		   "########################################");
+	}
+    }
+}
+/*************************************************
+ * end lifecycle tracing helper routines
+ *************************************************/
+
+
+/*********************************************
+ * Helper routines for shell variables
+ *********************************************/
+
+/*
+ * Every variable keeps its "NAME=value" string, so the environment a
+ * command gets is just an array of pointers to the exported ones. The
+ * shell starts out using the environment it was given, with nothing
+ * copied: the inherited strings are pointed to, not duplicated, and
+ * envp is libc's own array until a change to an exported variable
+ * marks it dirty. Then env_get rebuilds it once, and spawns go on
+ * using the prebuilt array until the next change.
+ */
+
+/* var_init - Make a variable of everything in the environment */
+void var_init(void)
+{
+    struct var_t *v;
+    char **e, *eq;
+    unsigned b;
+
+    for (e = environ; *e != NULL; e++) {
+	if ((eq = strchr(*e, '=')) == NULL || var_find(*e, eq - *e) != NULL)
+	    continue;
+	if ((v = malloc(sizeof(struct var_t))) == NULL)
+	    unix_error("var_init: malloc");
+	v->str = *e;
+	v->namelen = eq - *e;
+	v->exported = 1;
+	v->owned = 0;
+	b = varhash(*e, v->namelen);
+	v->next = vartab[b];
+	vartab[b] = v;
+    }
+    envp = environ;
+}
+
+/* varhash - FNV-1a hash of the len bytes of a variable name */
+unsigned varhash(const char *name, size_t len)
+{
+    unsigned h = 2166136261u;
+
+    while (len-- > 0) {
+	h ^= (unsigned char)*name++;
+	h *= 16777619u;
+    }
+    return h % VARHASH;
+}
+
+/* var_find - Return the variable named by the len bytes at name, or NULL */
+struct var_t *var_find(const char *name, size_t len)
+{
+    struct var_t *v;
+
+    for (v = vartab[varhash(name, len)]; v != NULL; v = v->next)
+	if (v->namelen == len && memcmp(v->str, name, len) == 0)
+	    return v;
+    return NULL;
+}
+
+/* var_get - Return the value of variable name, or NULL if it is unset */
+char *var_get(const char *name)
+{
+    struct var_t *v = var_find(name, strlen(name));
+
+    return v != NULL ? v->str + v->namelen + 1 : NULL;
+}
+
+/*
+ * var_set - Give the variable named by the len bytes at name a value,
+ *    creating it if need be, and export it too if export is set.
+ *    Returns -1 after complaining if name isn't a valid name.
+ */
+int var_set(const char *name, size_t len, const char *value, int export)
+{
+    struct var_t *v;
+    size_t vlen = strlen(value);
+    unsigned b;
+    char *str;
+
+    if (!var_name(name, len)) {
+	printf("%.*s: not a valid identifier\n", (int)len, name);
+	return -1;
+    }
+    if ((str = malloc(len + vlen + 2)) == NULL)
+	unix_error("var_set: malloc");
+    memcpy(str, name, len);
+    str[len] = '=';
+    memcpy(str + len + 1, value, vlen + 1);
+    if ((v = var_find(name, len)) == NULL) {
+	if ((v = calloc(1, sizeof(struct var_t))) == NULL)
+	    unix_error("var_set: calloc");
+	v->namelen = len;
+	b = varhash(name, len);
+	v->next = vartab[b];
+	vartab[b] = v;
+    } else {
+	var_retire(v);
+    }
+    v->str = str;
+    v->owned = 1;
+    v->exported |= export;
+    envdirty |= v->exported;
+    return 0;
+}
+
+/* var_unset - Remove variable name, if there is one */
+void var_unset(const char *name)
+{
+    size_t len = strlen(name);
+    struct var_t **pv, *v;
+
+    for (pv = &vartab[varhash(name, len)]; (v = *pv) != NULL; pv = &v->next) {
+	if (v->namelen == len && memcmp(v->str, name, len) == 0) {
+	    *pv = v->next;
+	    envdirty |= v->exported;
+	    var_retire(v);
+	    free(v);
+	    return;
+	}
+    }
+}
+
+/*
+ * var_retire - Let go of v's string. An exported one is still in
+ *    envp, and so in environ, until env_get rebuilds it, so it is only
+ *    put on envstale then and freed there.
+ */
+void var_retire(struct var_t *v)
+{
+    if (!v->owned)
+	return;
+    if (!v->exported) {
+	free(v->str);
+	return;
+    }
+    if (nenvstale == envstalecap) {
+	envstalecap = envstalecap ? 2 * envstalecap : 8;
+	if ((envstale = realloc(envstale, envstalecap * sizeof(char *))) == NULL)
+	    unix_error("var_retire: realloc");
+    }
+    envstale[nenvstale++] = v->str;
+}
+
+/* var_name - Is the len bytes at name a valid variable name? */
+int var_name(const char *name, size_t len)
+{
+    size_t i;
+
+    if (len == 0 || isdigit((unsigned char)name[0]))
+	return 0;
+    for (i = 0; i < len; i++)
+	if (!isalnum((unsigned char)name[i]) && name[i] != '_')
+	    return 0;
+    return 1;
+}
+
+/*
+ * env_get - Return the environment for execve, rebuilding it first
+ *    only if an exported variable changed since it was last built.
+ *    environ is pointed at it too, so libc's getenv and PATH search
+ *    see the same thing, and only then are the strings it used to
+ *    hold freed.
+ */
+char **env_get(void)
+{
+    struct var_t *v;
+    int i, n = 0;
+
+    if (!envdirty)
+	return envp;
+    for (i = 0; i < VARHASH; i++)
+	for (v = vartab[i]; v != NULL; v = v->next)
+	    n += v->exported;
+    if (n + 1 > envcap) {
+	if ((envp = realloc(envcap ? envp : NULL, (n + 1) * sizeof(char *))) == NULL)
+	    unix_error("env_get: realloc");
+	envcap = n + 1;
+    }
+    for (i = 0, n = 0; i < VARHASH; i++)
+	for (v = vartab[i]; v != NULL; v = v->next)
+	    if (v->exported)
+		envp[n++] = v->str;
+    envp[n] = NULL;
+    environ = envp;
+    envdirty = 0;
+    while (nenvstale > 0)
+	free(envstale[--nenvstale]);
+    return envp;
+}
+
+/*
+ * cmd_env - Return the environment cmd should run with: the shell's,
+ *    unless the command has NAME=value words of its own, in which case
+ *    a copy with those added or replacing is made in the token arena
+ */
+char **cmd_env(struct cmd_t *cmd)
+{
+    char **env = env_get(), **e, **copy;
+    size_t len;
+    int n, i, k;
+
+    if (cmd->nassigns == 0)
+	return env;
+    for (n = 0; env[n] != NULL; n++)
+	;
+    copy = tokalloc((n + cmd->nassigns + 1) * sizeof(char *));
+    for (e = env, k = 0; *e != NULL; e++) {
+	for (i = 0; i < cmd->nassigns; i++) {
+	    len = strchr(cmd->assigns[i], '=') - cmd->assigns[i] + 1;
+	    if (strncmp(*e, cmd->assigns[i], len) == 0)
+		break;
+	}
+	if (i == cmd->nassigns)
+	    copy[k++] = *e;
+    }
+    for (i = 0; i < cmd->nassigns; i++)
+	copy[k++] = cmd->assigns[i];
+    copy[k] = NULL;
+    return copy;
+}
+
+/*
+ * cmd_path - Return the value of the last PATH=value word cmd has,
+ *    or NULL if it runs with the shell's PATH
+ */
+char *cmd_path(struct cmd_t *cmd)
+{
+    int i;
+
+    for (i = cmd->nassigns - 1; i >= 0; i--)
+	if (strncmp(cmd->assigns[i], "PATH=", 5) == 0)
+	    return cmd->assigns[i] + 5;
+    return NULL;
+}
+
+/*********************************************
+ * end shell variable helper routines
+ *********************************************/
+
+
+/*********************************************
+ * Helper routines for the builtin table
+ *********************************************/
+
+/*
+ * The builtins, looked up by a perfect hash of the first and last
+ * characters and the length of the name: no two of them share a slot,
+ * so a lookup is one hash and at most one strcmp. bltn_init checks
+ * that, and a name added here that collides needs new constants in
+ * bltnhash.
+ */
+static const struct builtin_t builtins[] = {
+    { "exit",     BLTN_EXIT,     0 },
+    { "killall",  BLTN_KILLALL,  0 },
+    { "jobs",     BLTN_JOBS,     0 },
+    { "bg",       BLTN_BGFG,     0 },
+    { "fg",       BLTN_BGFG,     0 },
+    { "hash",     BLTN_HASH,     0 },
+    { "parallel", BLTN_PARALLEL, 0 },
+    { "trace",    BLTN_TRACE,    0 },
+    { "cd",       BLTN_CD,       0 },
+    { "echo",     BLTN_ECHO,     2 },
+    { "printf",   BLTN_PRINTF,   1 },
+    { "true",     BLTN_TRUE,     2 },
+    { "false",    BLTN_FALSE,    2 },
+    { "test",     BLTN_TEST,     1 },
+    { "[",        BLTN_TEST,     1 },
+    { "pwd",      BLTN_PWD,      1 },
+    { "history",  BLTN_HISTORY,  0 },
+    { "export",   BLTN_EXPORT,   0 },
+    { "unset",    BLTN_UNSET,    0 },
+    { "output",   BLTN_OUTPUT,   0 },
+};
+#define NBUILTINS (int)(sizeof(builtins) / sizeof(builtins[0]))
+
+/* bltnhash - Slot of a builtin name of length len (len > 0) */
+unsigned bltnhash(const char *name, size_t len)
+{
+    return (7 * (unsigned char)name[0] + 14 * (unsigned char)name[len - 1]
+	    + len) & (BLTNSLOTS - 1);
+}
+
+/* bltn_init - Fill in the builtin table's slots */
+void bltn_init(void)
+{
+    unsigned h;
+    int i;
+
+    for (i = 0; i < NBUILTINS; i++) {
+	h = bltnhash(builtins[i].name, strlen(builtins[i].name));
+	if (bltnslot[h] != 0)
+	    app_error("bltn_init: builtin names collide");
+	bltnslot[h] = i + 1;
+    }
+}
+
+/*
+ * builtin_lookup - Return the BLTN_* type of the builtin called name,
+ *    or BLTN_UNK. Utilities that do all the coreutils program does
+ *    (echo, true, false) also answer to /bin/name and /usr/bin/name;
+ *    the others only stand in for the bare name, as in bash. None of
+ *    them do when bg is set: "echo hi &" is still a job of its own.
+ */
+int builtin_lookup(const char *name, int bg)
+{
+    const struct builtin_t *b;
+    size_t len = strlen(name);
+    int path = 0, i;
+
+    if (name[0] == '/') {
+	if (strncmp(name, "/bin/", 5) == 0)
+	    path = 5;
+	else if (strncmp(name, "/usr/bin/", 9) == 0)
+	    path = 9;
+	else
+	    return BLTN_UNK;
+	name += path;
+	len -= path;
+    }
+    if (len == 0 || (i = bltnslot[bltnhash(name, len)]) == 0)
+	return BLTN_UNK;
+    b = &builtins[i - 1];
+    if (strcmp(b->name, name) != 0 || (path && b->utility < 2) ||
+	(bg && b->utility))
+	return BLTN_UNK;
+    return b->type;
+}
+
+/*
+ * unescape - Decode the backslash escape that s points just past into
+ *    *c, and return the number of characters after the backslash it
+ *    used: 0 if it isn't an escape (*c is then the backslash itself),
+ *    or -1 for \c. Octal escapes take three digits after the
+ *    backslash, or after a leading 0 if zerolead is set (echo -e and
+ *    printf %b), and \xHH takes two hex digits.
+ */
+int unescape(const char *s, int zerolead, char *c)
+{
+    const char *p = s;
+    int n, v;
+
+    switch (*p++) {
+    case 'a':  *c = '\a'; break;
+    case 'b':  *c = '\b'; break;
+    case 'c':  return -1;
+    case 'e':  *c = 033;  break;
+    case 'f':  *c = '\f'; break;
+    case 'n':  *c = '\n'; break;
+    case 'r':  *c = '\r'; break;
+    case 't':  *c = '\t'; break;
+    case 'v':  *c = '\v'; break;
+    case '\\': *c = '\\'; break;
+    case 'x':
+	for (v = 0, n = 0; n < 2 && isxdigit((unsigned char)*p); n++, p++)
+	    v = v * 16 + (isdigit((unsigned char)*p) ? *p - '0'
+			  : tolower((unsigned char)*p) - 'a' + 10);
+	if (n == 0) {
+	    *c = '\\';
+	    return 0;
+	}
+	*c = v;
+	break;
+    case '0': case '1': case '2': case '3':
+    case '4': case '5': case '6': case '7':
+	p = s;
+	if (zerolead && *p == '0')
+	    p++;
+	for (v = 0, n = 0; n < 3 && *p >= '0' && *p <= '7'; n++, p++)
+	    v = v * 8 + *p - '0';
+	*c = v;
+	break;
+    default:
+	*c = '\\';
+	return 0;
+    }
+    return p - s;
+}
+
+/*
+ * putescaped - Print s with its backslash escapes decoded. Returns -1
+ *    if it stopped at a \c, else 0.
+ */
+int putescaped(const char *s, int zerolead)
+{
+    char c;
+    int n;
+
+    for (; *s != '\0'; s++) {
+	if (*s != '\\') {
+	    putchar(*s);
+	    continue;
+	}
+	if ((n = unescape(s + 1, zerolead, &c)) < 0)
+	    return -1;
+	putchar(c);
+	s += n;
+    }
+    return 0;
+}
+
+/*
+ * numcheck - Complain, as printf does, if a numeric argument wasn't
+ *    all used up by the conversion that ended at end
+ */
+void numcheck(const char *arg, const char *end)
+{
+    if (*end != '\0') {
+	printf("printf: %s: expected a numeric value\n", arg);
+	laststatus = 1;
+    }
+}
+
+/*
+ * intarg, uintarg, floatarg - Convert printf's numeric argument a.
+ *    One that starts with ' or " is the value of the character after
+ *    the quote.
+ */
+long long intarg(const char *a)
+{
+    long long v;
+    char *endp;
+
+    if (*a == '\'' || *a == '"')
+	return (unsigned char)a[1];
+    v = strtoll(a, &endp, 0);
+    numcheck(a, endp);
+    return v;
+}
+
+unsigned long long uintarg(const char *a)
+{
+    unsigned long long v;
+    char *endp;
+
+    if (*a == '\'' || *a == '"')
+	return (unsigned char)a[1];
+    v = strtoull(a, &endp, 0);
+    numcheck(a, endp);
+    return v;
+}
+
+double floatarg(const char *a)
+{
+    double v;
+    char *endp;
+
+    if (*a == '\'' || *a == '"')
+	return (unsigned char)a[1];
+    v = strtod(a, &endp);
+    numcheck(a, endp);
+    return v;
+}
+
+/*
+ * shquote - Return s quoted so the shell would read it back as one
+ *    word, for printf %q: '' when it is empty, $'...' when it has
+ *    control characters, and otherwise with a backslash before each
+ *    character the shell treats specially. The copy is made in the
+ *    token arena.
+ */
+char *shquote(const char *s)
+{
+    static const char *names = "\aa\bb\tt\nn\vv\ff\rr";
+    char *buf = tokalloc(4 * strlen(s) + 4), *d = buf;
+    const char *p, *e;
+
+    if (*s == '\0')
+	return strcpy(buf, "''");
+    for (p = s; *p != '\0' && !iscntrl((unsigned char)*p); p++)
+	;
+    if (*p != '\0') {
+	d += sprintf(d, "$'");
+	for (p = s; *p != '\0'; p++) {
+	    if ((e = strchr(names, *p)) != NULL && (e - names) % 2 == 0)
+		d += sprintf(d, "\\%c", e[1]);
+	    else if (iscntrl((unsigned char)*p))
+		d += sprintf(d, "\\%03o", (unsigned char)*p);
+	    else if (*p == '\'' || *p == '\\')
+		d += sprintf(d, "\\%c", *p);
+	    else
+		*d++ = *p;
+	}
+	strcpy(d, "'");
+	return buf;
+    }
+    for (p = s; *p != '\0'; p++) {
+	if (!isalnum((unsigned char)*p) && strchr("_-./,:=+@%^", *p) == NULL &&
+	    ((*p != '~' && *p != '#') || p == s))
+	    *d++ = '\\';
+	*d++ = *p;
+    }
+    *d = '\0';
+    return buf;
+}
+
+/*********************************************
+ * end builtin table helper routines
+ *********************************************/
+
+
+/*********************************************
+ * Helper routines for the command history
+ *********************************************/
+
+/*
+ * The history file is only ever appended to, one line per command,
+ * each with a single O_APPEND write, so shells sharing it never tear
+ * each other's lines. It is mapped rather than read, and nothing is
+ * parsed at startup: the index (entry offsets and a prefix trie) is
+ * brought up to date by hist_sync the first time it is needed, and
+ * after that only the lines added since are looked at, whichever
+ * shell wrote them.
+ */
+
+/*
+ * hist_open - Use file for the history, mapping what it already
+ *    holds. Returns 0, or -1 after saying why not.
+ */
+int hist_open(const char *file)
+{
+    int fd;
+
+    if ((fd = open(file, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600)) < 0) {
+	printf("history: %s: %s\n", file, strerror(errno));
+	return -1;
+    }
+    hist_close();
+    if (hist.nodes == NULL) {
+	hist.nodecap = 1024;
+	if ((hist.nodes = malloc(hist.nodecap * sizeof(struct histnode_t))) == NULL)
+	    unix_error("hist_open: malloc");
+    }
+    hist.fd = fd;
+    hist.file = strdup(file);
+    hist.nnodes = 1;                    /* the root */
+    hist.nodes[0].child = hist.nodes[0].sibling = 0;
+    hist.nodes[0].last = -1;
+    return 0;
+}
+
+/* hist_close - Stop using the history file and forget its index */
+void hist_close(void)
+{
+    if (hist.fd >= 0)
+	close(hist.fd);
+    if (hist.map != NULL)
+	munmap(hist.map, hist.mapsize);
+    free(hist.file);
+    hist.fd = -1;
+    hist.file = NULL;
+    hist.map = NULL;
+    hist.mapsize = hist.indexed = 0;
+    hist.nents = 0;
+    hist.nnodes = 1;
+}
+
+/*
+ * hist_add - Append a command line to the history file, unless it is
+ *    blank. The line and a newline go out in one write.
+ */
+void hist_add(const char *line, size_t len)
+{
+    struct iovec iov[2];
+
+    if (hist.fd < 0 || line[strspn(line, " \t\n")] == '\0')
+	return;
+    if (line[len - 1] == '\n')
+	len--;
+    iov[0].iov_base = (char *)line;
+    iov[0].iov_len = len;
+    iov[1].iov_base = "\n";
+    iov[1].iov_len = 1;
+    if (writev(hist.fd, iov, 2) < 0)
+	printf("history: %s: %s\n", hist.file, strerror(errno));
+}
+
+/*
+ * hist_sync - Map whatever has been appended to the history file since
+ *    the last call, by this shell or another, and index the complete
+ *    lines in it. Returns the number of entries.
+ */
+long hist_sync(void)
+{
+    struct stat st;
+    char *map, *p, *nl, *lim;
+
+    if (hist.fd < 0 || fstat(hist.fd, &st) < 0)
+	return hist.nents;
+    if ((size_t)st.st_size > hist.mapsize) {
+	if (hist.map == NULL)
+	    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, hist.fd, 0);
+	else
+	    map = mremap(hist.map, hist.mapsize, st.st_size, MREMAP_MAYMOVE);
+	if (map == MAP_FAILED)
+	    return hist.nents;
+	hist.map = map;
+	hist.mapsize = st.st_size;
+    }
+    lim = hist.map + hist.mapsize;
+    for (p = hist.map + hist.indexed; p < lim; p = nl + 1) {
+	if ((nl = memchr(p, '\n', lim - p)) == NULL)
+	    break;                      /* another shell is mid-write */
+	hist_index(p - hist.map, nl - p);
+    }
+    hist.indexed = p - hist.map;
+    return hist.nents;
+}
+
+/*
+ * hist_index - Add the entry of len bytes at offset off to the index.
+ *    Every trie node on the way down its first HISTDEPTH bytes learns
+ *    it is the latest entry there, and the one it ends at chains it to
+ *    the entry that was latest there before it.
+ */
+void hist_index(size_t off, size_t len)
+{
+    const char *s = hist.map + off;
+    size_t i;
+    int node = 0, n;
+
+    if (hist.nents == hist.entcap) {
+	hist.entcap = hist.entcap ? 2 * hist.entcap : 1024;
+	if ((hist.off = realloc(hist.off, hist.entcap * sizeof(size_t))) == NULL ||
+	    (hist.chain = realloc(hist.chain, hist.entcap * sizeof(long))) == NULL)
+	    unix_error("hist_index: realloc");
+    }
+    hist.off[hist.nents] = off;
+    for (i = 0; i < len && i < HISTDEPTH; i++) {
+	hist.nodes[node].last = hist.nents;
+	for (n = hist.nodes[node].child; n != 0; n = hist.nodes[n].sibling)
+	    if (hist.nodes[n].c == (unsigned char)s[i])
+		break;
+	if (n == 0) {
+	    if (hist.nnodes == hist.nodecap) {
+		hist.nodecap *= 2;
+		hist.nodes = realloc(hist.nodes,
+				     hist.nodecap * sizeof(struct histnode_t));
+		if (hist.nodes == NULL)
+		    unix_error("hist_index: realloc");
+	    }
+	    n = hist.nnodes++;
+	    hist.nodes[n].c = s[i];
+	    hist.nodes[n].child = 0;
+	    hist.nodes[n].sibling = hist.nodes[node].child;
+	    hist.nodes[n].last = -1;
+	    hist.nodes[node].child = n;
+	}
+	node = n;
+    }
+    hist.chain[hist.nents] = hist.nodes[node].last;
+    hist.nodes[node].last = hist.nents++;
+}
+
+/* hist_entry - Return entry e (counting from 0) and its length */
+const char *hist_entry(long e, size_t *len)
+{
+    size_t end = e + 1 < hist.nents ? hist.off[e + 1] : hist.indexed;
+
+    *len = end - hist.off[e] - 1;
+    return hist.map + hist.off[e];
+}
+
+/* hist_entryat - Return the entry holding the byte at offset off */
+long hist_entryat(size_t off)
+{
+    long lo = 0, hi = hist.nents - 1, mid;
+
+    while (lo < hi) {
+	mid = (lo + hi + 1) / 2;
+	if (hist.off[mid] <= off)
+	    lo = mid;
+	else
+	    hi = mid - 1;
+    }
+    return lo;
+}
+
+/*
+ * hist_find - Return the latest entry starting with the len bytes at
+ *    prefix, or -1. The trie answers prefixes of up to HISTDEPTH bytes
+ *    by itself; longer ones follow the chain of entries that share
+ *    the first HISTDEPTH bytes.
+ */
+long hist_find(const char *prefix, size_t len)
+{
+    const char *s;
+    size_t i, n;
+    int node = 0, c;
+    long e;
+
+    hist_sync();
+    for (i = 0; i < len && i < HISTDEPTH; i++) {
+	for (c = hist.nodes[node].child; c != 0; c = hist.nodes[c].sibling)
+	    if (hist.nodes[c].c == (unsigned char)prefix[i])
+		break;
+	if (c == 0)
+	    return -1;
+	node = c;
     }
-    else{
-    	//it will do the same prtocess as the if statement before except
-    	//it will perform a waitFG as the command was indicated that it should be run in the foreground.
-        kill(-pidVal, SIGCONT);
-        job->state =FG;
-        waitfg(pidVal);
+    for (e = hist.nodes[node].last; e >= 0 && len > HISTDEPTH; e = hist.chain[e]) {
+	s = hist_entry(e, &n);
+	if (n >= len && memcmp(s, prefix, len) == 0)
+	    break;
     }
-    return;
+    return e;
 }
 
-/* 
- * waitfg - Block until process pid is no longer the foreground process
+/*
+ * hist_expand - Expand a line starting with '!': "!!" is the last
+ *    command, "!N" command number N and "!prefix" the latest command
+ *    starting with prefix. Whatever follows the first word is kept.
+ *    Prints and returns the expanded line, or NULL if there is no
+ *    such command.
  */
-void waitfg(pid_t pid)
+char *hist_expand(char *line, size_t *len)
 {
-	//this will create a foreground sleep where the shell will wait until the foreground process is completed
-    struct job_t *job = getprocessid(jobs, pid);
-    while(job->state == FG){
-        sleep(1);
+    const char *s;
+    size_t word, n;
+    long e, nents = hist_sync();
+    char *end;
+
+    word = strcspn(line, " \t\n");
+    if (word == 2 && line[1] == '!') {
+	e = nents - 1;
+    } else if (isdigit((unsigned char)line[1])) {
+	e = strtol(line + 1, &end, 10) - 1;
+	if (end != line + word || e >= nents)
+	    e = -1;
+    } else {
+	e = word > 1 ? hist_find(line + 1, word - 1) : -1;
     }
-    return;
+    if (e < 0) {
+	printf("%.*s: event not found\n", (int)word, line);
+	return NULL;
+    }
+    s = hist_entry(e, &n);
+    if (n + *len - word + 1 > hist.linesize) {
+	hist.linesize = n + *len - word + 1;
+	if ((hist.line = realloc(hist.line, hist.linesize)) == NULL)
+	    unix_error("hist_expand: realloc");
+    }
+    memcpy(hist.line, s, n);
+    memcpy(hist.line + n, line + word, *len - word + 1);
+    *len = n + *len - word;
+    printf("%.*s\n", (int)(*len - (hist.line[*len - 1] == '\n')), hist.line);
+    return hist.line;
 }
 
-/*****************
- * Signal handlers
- *****************/
+/*********************************************
+ * end command history helper routines
+ *********************************************/
 
-/* 
- * sigchld_handler - The kernel sends a SIGCHLD to the shell whenever
- *     a child job terminates (becomes a zombie), or stops because it
- *     received a SIGSTOP or SIGTSTP signal. The handler reaps all
- *     available zombie children, but doesn't wait for any other
- *     currently running children to terminate.  
+
+/*********************************************
+ * Helper routines for the command hash table
+ *********************************************/
+
+/* hashname - FNV-1a hash of a command name */
+unsigned hashname(const char *name)
+{
+    unsigned h = 2166136261u;
+
+    while (*name) {
+	h ^= (unsigned char)*name++;
+	h *= 16777619u;
+    }
+    return h;
+}
+
+/* path_flush - Forget every remembered command location */
+void path_flush(void)
+{
+    struct pathent_t *ent, *next;
+    int i;
+
+    for (i = 0; i < HASHSIZE; i++) {
+	for (ent = pathtab[i]; ent != NULL; ent = next) {
+	    next = ent->next;
+	    free(ent->name);
+	    free(ent->path);
+	    free(ent);
+	}
+	pathtab[i] = NULL;
+    }
+}
+
+/*
+ * path_validate - Throw the table away if PATH was changed or if
+ *    any PATH directory was modified since the table was filled.
+ *    inotify reports changes to the directories it can watch; the
+ *    rest (relative ones, ones that don't exist yet) are stat'ed,
+ *    which is still far cheaper than the failed execve calls that
+ *    execvp makes while searching.
  */
-void sigchld_handler(int sig) 
+void path_validate(void)
 {
-    pid_t pidVal;
-    int stVal;
-    //because there are multiple children possible
-    //we need to utilize a while statement in order to properly 
-    //stop, reap zombie children, or kill due to a SIGINT 
-    while ((pidVal = waitpid(-1, &stVal, WNOHANG|WUNTRACED)) > 0)
-    {
-        if(WIFSIGNALED(stVal))
-        {
-        	//SIGINT signal value == 2
-            int jidVal = get_jid_from_pid(pidVal);
-            printf("Job [%d] (%d) terminated by signal 2\n", jidVal, pidVal);
-            removejob(jobs, pidVal);
-        }
-        else if(WIFSTOPPED(stVal))
-        {
-        	//SIGSTP VAL == 20
-            int jidVal = get_jid_from_pid(pidVal);
-            printf("Job [%d] (%d) stopped by signal 20\n", jidVal, pidVal);
-            sigtstp_handler(20);
-        }
-        else if(WIFEXITED(stVal))
-        {
-            removejob(jobs, pidVal);
-        }
+    const char *env = var_get("PATH");
+    struct stat st;
+    char *p, *dir;
+    int i, stale = 0;
+
+    if (env == NULL)
+	env = "/bin:/usr/bin";
+    if (inofd == -1 && (inofd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0)
+	inofd = -2;
+
+    if (pathstr == NULL || strcmp(pathstr, env) != 0) {
+	/* PATH itself changed: rebuild the directory list */
+	for (i = 0; i < npathdirs; i++) {
+	    if (pathdirs[i].wd >= 0)
+		inotify_rm_watch(inofd, pathdirs[i].wd);
+	    dirlist_free(&pathdirs[i].list);
+	    free(pathdirs[i].dir);
+	}
+	free(pathdirs);
+	free(pathstr);
+	pathstr = strdup(env);
+	npathdirs = 1;
+	for (p = pathstr; *p; p++)
+	    if (*p == ':')
+		npathdirs++;
+	pathdirs = calloc(npathdirs, sizeof(struct pathdir_t));
+	p = strdup(env);
+	for (i = 0, dir = p; i < npathdirs; i++) {
+	    char *colon = strchr(dir, ':');
+	    if (colon != NULL)
+		*colon = '\0';
+	    pathdirs[i].dir = strdup(*dir ? dir : ".");
+	    pathdirs[i].mtime.tv_sec = -1;
+	    pathdirs[i].wd = -1;
+	    if (inofd >= 0 && pathdirs[i].dir[0] == '/')
+		pathdirs[i].wd = inotify_add_watch(inofd, pathdirs[i].dir,
+		    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+		    IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+	    if (colon == NULL)
+		break;              /* that was the last entry */
+	    dir = colon + 1;
+	}
+	free(p);
+	stale = 1;
     }
-    return;
+
+    if (inofd >= 0 && path_events())
+	stale = 1;
+    for (i = 0; i < npathdirs; i++) {
+	if (pathdirs[i].wd >= 0)
+	    continue;
+	if (stat(pathdirs[i].dir, &st) < 0)
+	    st.st_mtim.tv_sec = st.st_mtim.tv_nsec = 0;
+	if (st.st_mtim.tv_sec != pathdirs[i].mtime.tv_sec ||
+	    st.st_mtim.tv_nsec != pathdirs[i].mtime.tv_nsec) {
+	    pathdirs[i].mtime = st.st_mtim;
+	    pathdirs[i].listed = 0;
+	    stale = 1;
+	}
+    }
+    if (stale)
+	path_flush();
 }
 
 /*
- * sigalrm_handler - The kernel sends a SIGALRM to the shell after
- * alarm(timeout) times out. Catch it and send a SIGINT to every
- * EXISTING (pid != 0) job
+ * path_events - Read what inotify has queued about the PATH
+ *    directories, marking the ones that changed to be listed again.
+ *    Returns 1 if any did.
  */
+int path_events(void)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct inotify_event *ev;
+    ssize_t n;
+    char *p;
+    int i, changed = 0;
+
+    while ((n = read(inofd, buf, sizeof(buf))) > 0) {
+	for (p = buf; p < buf + n; p += sizeof(*ev) + ev->len) {
+	    ev = (struct inotify_event *)p;
+	    for (i = 0; i < npathdirs; i++) {
+		if (ev->wd != pathdirs[i].wd && !(ev->mask & IN_Q_OVERFLOW))
+		    continue;
+		pathdirs[i].listed = 0;
+		/* the directory went away: stat it until it is back */
+		if (ev->mask & IN_IGNORED)
+		    pathdirs[i].wd = -1;
+	    }
+	    changed = 1;
+	}
+    }
+    return changed;
+}
 
-void sigalrm_handler(int sig)
+/*
+ * path_lookup - Return the absolute path of command name, searching
+ *    PATH only when it isn't in the table yet. Returns NULL if no
+ *    PATH directory holds an executable file of that name. The search
+ *    goes through the directories' catalogs, so only a directory that
+ *    has the name is stat'ed, and a name nobody has costs no syscalls.
+ *    hit is set only by the lookup that runs the command, so the
+ *    entry's count is the number of times it was run, as in bash.
+ */
+char *path_lookup(const char *name, int hit)
 {
-    struct job_t *job;
-    pid_t pidVal;
-    //if there are no zombie children or currently running jobs no need to kill all
-    if(maxjid(jobs) == 0)
-    {
-        return;
+    struct pathent_t *ent;
+    struct stat st;
+    unsigned b = hashname(name) % HASHSIZE;
+    char *buf;
+    int i;
+
+    path_validate();
+    for (ent = pathtab[b]; ent != NULL; ent = ent->next) {
+	if (strcmp(ent->name, name) == 0) {
+	    ent->hits += hit;
+	    return ent->path;
+	}
     }
-    //utilize the for loop to iterate through all of the available jobs and kill them
-    for(int i =1; i < MAXJOBS; i++)
-    {
-    	//if the job id is equivalent to NULL there is no need to run a kill 
-    	//so simply return before trying to kill a NULL
-    	//this tripped me up for a long while.
-        if((job =getjobid(jobs, i)) == NULL)
-        {
-            return;
-        }
-        // utilize the job pointer to access the PID value and store in the 
-        //pidVal integer to be passed to the kill function
-        pidVal = job->pid;
-        kill(pidVal, SIGINT);
+
+    for (i = 0; i < npathdirs; i++) {
+	if (!pathdirs[i].listed) {
+	    dirlist_read(pathdirs[i].dir, &pathdirs[i].list);
+	    pathdirs[i].listed = 1;
+	}
+	if (dirlist_find(&pathdirs[i].list, name) == NULL)
+	    continue;
+	buf = malloc(strlen(pathdirs[i].dir) + strlen(name) + 2);
+	sprintf(buf, "%s/%s", pathdirs[i].dir, name);
+	if (stat(buf, &st) == 0 && S_ISREG(st.st_mode) &&
+	    access(buf, X_OK) == 0) {
+	    ent = malloc(sizeof(struct pathent_t));
+	    ent->name = strdup(name);
+	    ent->path = buf;
+	    ent->hits = hit;
+	    ent->next = pathtab[b];
+	    pathtab[b] = ent;
+	    return buf;
+	}
+	free(buf);
     }
-    return;
+    return NULL;
 }
 
-/* 
- * sigint_handler - The kernel sends a SIGINT to the shell whenver the
- *    user types ctrl-c at the keyboard.  Catch it and send it along
- *    to the foreground job.  
+/*
+ * path_search - Return the path of the first executable file called
+ *    name in the colon-separated directory list path, built in the
+ *    token arena, or NULL if there is none. This is for commands that
+ *    set their own PATH, so it bypasses the catalogs and the table.
  */
-void sigint_handler(int sig) 
+char *path_search(const char *name, const char *path)
 {
-	//this is a relatively simplistic approach to handling a SIGINT call
-	//the first thing we need to do is acquire the foregroud pid and store it in 
-	//pidVal to be passed to kill with the SIGINT value after making sure the pid is 
-	//non-zero otherwise there would be no need for the kill to occur
-	//thus why the return lives outside of the for loop
-    pid_t pidVal = fgpid(jobs);
-    if(pidVal != 0)
-    {    
-        kill(-pidVal, SIGINT);
+    struct stat st;
+    const char *dir, *end;
+    size_t dlen, nlen = strlen(name);
+    char *buf;
+
+    for (dir = path; ; dir = end + 1) {
+	if ((end = strchr(dir, ':')) == NULL)
+	    end = dir + strlen(dir);
+	dlen = end - dir;
+	buf = tokalloc(dlen + nlen + 3);
+	if (dlen == 0)
+	    sprintf(buf, "./%s", name);	/* an empty entry is the cwd */
+	else
+	    sprintf(buf, "%.*s/%s", (int)dlen, dir, name);
+	if (stat(buf, &st) == 0 && S_ISREG(st.st_mode) &&
+	    access(buf, X_OK) == 0)
+	    return buf;
+	if (*end == '\0')
+	    return NULL;
     }
-    return;
 }
 
 /*
- * sigtstp_handler - The kernel sends a SIGTSTP to the shell whenever
- *     the user types ctrl-z at the keyboard. Catch it and suspend the
- *     foreground job by sending it a SIGTSTP.  
+ * path_complete - Collect the builtins and PATH commands starting with
+ *    the len bytes at prefix, sorted and without repeats. Returns how
+ *    many there are, with the names in *names, a malloc'd array the
+ *    caller frees; the strings belong to the catalogs.
  */
-void sigtstp_handler(int sig) 
+int path_complete(const char *prefix, size_t len, const char ***names)
 {
-	//again we use the pid_t struct to set the pid
-	//and set it using the foreground pid function
-	//we can then acquire the jid using this pidVal
-    pid_t pidVal = fgpid(jobs);
-    int jidVal = get_jid_from_pid(pidVal);
-    struct job_t *job;
-    //again we just make sure that the pidVal is not already 0'd before running
-    //kill processes
-    if(pidVal != 0){
-        job = getjobid(jobs, jidVal);
-        kill(-pidVal, SIGTSTP);
-        job->state = ST;
-        //and then I need to make sure that I indicate the job state is now set to stopped
-        //in case later use is intended
+    const char **v;
+    char *name;
+    int i, j, n = 0, cap = 64;
+
+    path_validate();
+    if ((v = malloc(cap * sizeof(char *))) == NULL)
+	unix_error("path_complete: malloc");
+    for (i = -1; i < npathdirs; i++) {
+	if (i >= 0 && !pathdirs[i].listed) {
+	    dirlist_read(pathdirs[i].dir, &pathdirs[i].list);
+	    pathdirs[i].listed = 1;
+	}
+	j = i < 0 ? 0 : dirlist_lower(&pathdirs[i].list, prefix, len);
+	for (;; j++) {
+	    if (i < 0) {
+		if (j == NBUILTINS)
+		    break;
+		if (strncmp(builtins[j].name, prefix, len) != 0)
+		    continue;
+		name = (char *)builtins[j].name;
+	    } else {
+		if (j == pathdirs[i].list.count)
+		    break;
+		name = pathdirs[i].list.sorted[j];
+		if (strncmp(name, prefix, len) != 0)
+		    break;
+		if (name[-1] == DT_DIR)
+		    continue;
+	    }
+	    if (n == cap && (v = realloc(v, (cap *= 2) * sizeof(char *))) == NULL)
+		unix_error("path_complete: realloc");
+	    v[n++] = name;
+	}
     }
-    //an added return after the if statement is useful to ensuring the cases where
-    //there are no foreground jobs to suspend so it can instead simply return 
-    //rather than attempting to kill non-existing processes
-    return;
+    qsort(v, n, sizeof(char *), cmpstr);
+    for (i = j = 0; i < n; i++)
+	if (j == 0 || strcmp(v[i], v[j - 1]) != 0)
+	    v[j++] = v[i];
+    *names = v;
+    return j;
 }
 
-/*********************
- * End signal handlers
- *********************/
+/*
+ * dirlist_read - Read the names in dir (all but . and ..) into dl,
+ *    with getdents64 in DENTBUF-sized batches, and sort them. Nothing
+ *    is stat'ed: each name is kept behind the d_type byte the kernel
+ *    gave for it. A directory that can't be read comes out empty.
+ */
+void dirlist_read(const char *dir, struct dirlist_t *dl)
+{
+    struct dent64 {                     /* what getdents64 returns */
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+    } *d;
+    char buf[DENTBUF] __attribute__((aligned(8)));
+    size_t used = 0, cap = 0, len;
+    char *names = NULL, *p;
+    long n, pos;
+    int fd, count = 0, i;
 
-/***********************************************
- * Helper routines that manipulate the job list
- **********************************************/
+    dirlist_free(dl);
+    if ((fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+	return;
+    while ((n = syscall(SYS_getdents64, fd, buf, sizeof(buf))) > 0) {
+	for (pos = 0; pos < n; pos += d->d_reclen) {
+	    d = (struct dent64 *)(buf + pos);
+	    if (d->d_name[0] == '.' && (d->d_name[1] == '\0' ||
+		(d->d_name[1] == '.' && d->d_name[2] == '\0')))
+		continue;
+	    len = strlen(d->d_name) + 2;
+	    if (used + len > cap) {
+		cap = cap ? 2 * cap : DENTBUF;
+		if ((names = realloc(names, cap)) == NULL)
+		    unix_error("dirlist_read: realloc");
+	    }
+	    names[used] = d->d_type;
+	    memcpy(names + used + 1, d->d_name, len - 1);
+	    used += len;
+	    count++;
+	}
+    }
+    close(fd);
+    if ((dl->sorted = malloc((count + 1) * sizeof(char *))) == NULL)
+	unix_error("dirlist_read: malloc");
+    for (i = 0, p = names; i < count; i++, p += strlen(p) + 1)
+	dl->sorted[i] = ++p;
+    qsort(dl->sorted, count, sizeof(char *), cmpstr);
+    dl->names = names;
+    dl->count = count;
+}
 
-/* clearjob - Clear the entries in a job struct */
-void clearjob(struct job_t *job) {
-    job->pid = 0;
-    job->jid = 0;
-    job->state = UNDEF;
-    job->cmdline[0] = '\0';
+/* dirlist_free - Forget the names in dl */
+void dirlist_free(struct dirlist_t *dl)
+{
+    free(dl->names);
+    free(dl->sorted);
+    dl->names = NULL;
+    dl->sorted = NULL;
+    dl->count = 0;
 }
 
-/* initjobs - Initialize the job list */
-void initjobs(struct job_t *jobs) {
-    int i;
+/* dirlist_find - Return name as it is in dl, or NULL */
+char *dirlist_find(const struct dirlist_t *dl, const char *name)
+{
+    char **hit;
 
-    for (i = 0; i < MAXJOBS; i++)
-	clearjob(&jobs[i]);
+    if (dl->count == 0)
+	return NULL;
+    hit = bsearch(&name, dl->sorted, dl->count, sizeof(char *), cmpstr);
+    return hit != NULL ? *hit : NULL;
 }
 
-/* maxjid - Returns largest allocated job ID */
-int maxjid(struct job_t *jobs) 
+/*
+ * dirlist_lower - Return the index of the first name in dl that
+ *    doesn't sort before the len bytes at prefix
+ */
+int dirlist_lower(const struct dirlist_t *dl, const char *prefix, size_t len)
 {
-    int i, max=0;
+    int lo = 0, hi = dl->count, mid;
 
-    for (i = 0; i < MAXJOBS; i++)
-	if (jobs[i].jid > max)
-	    max = jobs[i].jid;
-    return max;
+    while (lo < hi) {
+	mid = (lo + hi) / 2;
+	if (strncmp(dl->sorted[mid], prefix, len) < 0)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return lo;
+}
+
+/* cmpstr - qsort comparison of two string pointers */
+int cmpstr(const void *a, const void *b)
+{
+    return strcmp(*(char * const *)a, *(char * const *)b);
 }
+/*********************************************
+ * end command hash table helper routines
+ *********************************************/
 
-/* addjob - Add a job to the job list */
-int addjob(struct job_t *jobs, pid_t pid, int state, char *cmdline) 
+
+/*********************************************
+ * Helper routines for glob expansion
+ *********************************************/
+
+/*
+ * glob_word - Replace the word t with the paths its *, ? and [...]
+ *    match, in order, as tokens of their own, and return the last of
+ *    them. A pattern that matches nothing is left as it is.
+ */
+struct tok_t *glob_word(struct tok_t *t)
 {
+    struct globv_t gv = {NULL, 0, 0};
+    struct tok_t *u;
+    char path[PATH_MAX];
     int i;
-    
-    if (pid < 1)
-	return 0;
 
-    for (i = 0; i < MAXJOBS; i++) {
-	if (jobs[i].pid == 0) {
-	    jobs[i].pid = pid;
-	    jobs[i].state = state;
-	    jobs[i].jid = nextjid++;
-	    if (nextjid > MAXJOBS)
-		nextjid = 1;
-	    strcpy(jobs[i].cmdline, cmdline);
-  	    if(verbose){
-	        printf("Added job [%d] %d %s\n", jobs[i].jid, jobs[i].pid, jobs[i].cmdline);
-            }
-            return 1;
+    glob_walk(path, 0, t->s, &gv);
+    if (gv.n > 0) {
+	t->s = gv.v[0];
+	for (i = 1; i < gv.n; i++) {
+	    u = tokalloc(sizeof(*u));
+	    *u = *t;
+	    u->s = gv.v[i];
+	    t->next = u;
+	    t = u;
 	}
     }
-    printf("Tried to create too many jobs\n");
-    return 0;
+    free(gv.v);
+    return t;
 }
 
-/* removejob - Delete a job whose PID=pid from the job list */
-int removejob(struct job_t *jobs, pid_t pid) 
+/*
+ * glob_walk - Match pat, the rest of a pattern, against what is under
+ *    the len bytes of path, adding each whole path that matches to gv.
+ *    One component is matched at a time against its directory's
+ *    cached listing; a literal component is only checked when it is
+ *    the last one, and a directory is only stat'ed when its entry
+ *    doesn't say what it is. The literal part of a pattern keeps its
+ *    slashes as written, and a pattern ending in one only matches
+ *    directories.
+ */
+void glob_walk(char *path, size_t len, const char *pat, struct globv_t *gv)
 {
-    int i;
+    const struct dirlist_t *dl;
+    const char *pend, *q, *name;
+    size_t fixed, nlen;
+    struct stat st;
+    int i, last, magic;
 
-    if (pid < 1)
-	return 0;
+    for (; *pat == '/'; pat++) {
+	if (len + 1 >= PATH_MAX)
+	    return;
+	path[len++] = '/';
+    }
+    if (*pat == '\0') {
+	/* a trailing slash: what led here has to be a directory */
+	path[len] = '\0';
+	if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+	    glob_add(gv, path, len);
+	return;
+    }
+    pend = strchrnul(pat, '/');
+    last = *pend == '\0';
+    for (q = pat, magic = 0; q < pend; q++)
+	magic |= *q == '*' || *q == '?' || *q == '[';
+    if (!magic && !last) {
+	/* descend without looking: the next listing fails if it isn't there */
+	if (len + (pend - pat) + 1 >= PATH_MAX)
+	    return;
+	memcpy(path + len, pat, pend - pat);
+	glob_walk(path, len + (pend - pat), pend, gv);
+	return;
+    }
+    path[len] = '\0';
+    dl = glob_dir(len > 0 ? path : ".");
+    /* the names are sorted, so only those starting with the literal
+       part of the pattern need to be looked at */
+    fixed = strcspn(pat, "*?[");
+    if (fixed > (size_t)(pend - pat))
+	fixed = pend - pat;
+    for (i = dirlist_lower(dl, pat, fixed); i < dl->count; i++) {
+	name = dl->sorted[i];
+	if (strncmp(name, pat, fixed) != 0)
+	    break;
+	if (*name == '.' && *pat != '.')
+	    continue;                   /* hidden unless asked for */
+	if (!glob_match(pat, pend, name))
+	    continue;
+	nlen = strlen(name);
+	if (len + nlen + 1 >= PATH_MAX)
+	    continue;
+	memcpy(path + len, name, nlen + 1);
+	if (last) {
+	    glob_add(gv, path, len + nlen);
+	    continue;
+	}
+	if (name[-1] != DT_DIR && ((name[-1] != DT_LNK && name[-1] != DT_UNKNOWN) ||
+	    stat(path, &st) < 0 || !S_ISDIR(st.st_mode)))
+	    continue;
+	/* as in sh, a matched name is followed by just one slash */
+	path[len + nlen] = '/';
+	for (q = pend; *q == '/'; q++)
+	    ;
+	glob_walk(path, len + nlen + 1, q, gv);
+    }
+}
 
-    for (i = 0; i < MAXJOBS; i++) {
-	if (jobs[i].pid == pid) {
-	    clearjob(&jobs[i]);
-	    nextjid = maxjid(jobs)+1;
-	    return 1;
+/* glob_add - Add a copy of the len bytes of path to the matches in gv */
+void glob_add(struct globv_t *gv, const char *path, size_t len)
+{
+    char *p;
+
+    if (gv->n == gv->cap) {
+	gv->cap = gv->cap ? 2 * gv->cap : 16;
+	if ((gv->v = realloc(gv->v, gv->cap * sizeof(char *))) == NULL)
+	    unix_error("glob_add: realloc");
+    }
+    p = memcpy(tokalloc(len + 1), path, len);
+    p[len] = '\0';
+    gv->v[gv->n++] = p;
+}
+
+/*
+ * glob_match - Does name match the pattern from pat up to pend? *
+ *    matches any run of bytes, ? any one, and [...] any one of the
+ *    bytes or a-z ranges listed, or not listed if it starts with ! or
+ *    ^. Only the last * is ever backtracked to, so this is linear in
+ *    practice.
+ */
+int glob_match(const char *pat, const char *pend, const char *name)
+{
+    const char *star = NULL, *resume = NULL, *set, *close;
+    int hit, neg;
+
+    while (*name != '\0') {
+	if (pat < pend && *pat == '*') {
+	    star = ++pat;
+	    resume = name;
+	    continue;
+	}
+	close = NULL;
+	if (pat < pend && *pat == '[') {
+	    set = pat + 1;
+	    neg = set < pend && (*set == '!' || *set == '^');
+	    set += neg;
+	    /* a ] right at the start is one of the bytes */
+	    if (set < pend)
+		close = memchr(set + 1, ']', pend - set - 1);
+	}
+	if (close != NULL) {
+	    for (hit = 0; set < close; set++) {
+		if (set + 2 < close && set[1] == '-') {
+		    hit |= (unsigned char)*name >= (unsigned char)set[0] &&
+			   (unsigned char)*name <= (unsigned char)set[2];
+		    set += 2;
+		} else {
+		    hit |= *name == *set;
+		}
+	    }
+	    if (hit != neg) {
+		pat = close + 1;
+		name++;
+		continue;
+	    }
+	} else if (pat < pend && (*pat == '?' || *pat == *name)) {
+	    pat++;
+	    name++;
+	    continue;
 	}
+	if (star == NULL)
+	    return 0;
+	pat = star;                     /* let the * take one more byte */
+	name = ++resume;
     }
-    return 0;
+    while (pat < pend && *pat == '*')
+	pat++;
+    return pat == pend;
 }
 
-/* fgpid - Return PID of current foreground job, 0 if no such job */
-pid_t fgpid(struct job_t *jobs) {
-    int i;
+/*
+ * glob_dir - Return the names in dir, read with dirlist_read the first
+ *    time and kept until the directory's mtime (or the directory
+ *    itself) changes. A listing read within a second of the mtime
+ *    could have missed a change the clock didn't register, so it is
+ *    read again the next time. A directory that can't be stat'ed
+ *    comes back empty.
+ */
+const struct dirlist_t *glob_dir(const char *dir)
+{
+    static const struct dirlist_t none;
+    struct globdir_t *g;
+    struct timespec now;
+    struct stat st;
+    unsigned h;
 
-    for (i = 0; i < MAXJOBS; i++)
-	if (jobs[i].state == FG)
-	    return jobs[i].pid;
-    return 0;
+    if (stat(dir, &st) < 0)
+	return &none;
+    h = hashname(dir) & (GLOBHASH - 1);
+    for (g = globtab[h]; g != NULL; g = g->next)
+	if (strcmp(g->dir, dir) == 0)
+	    break;
+    if (g != NULL && !g->racy && g->dev == st.st_dev && g->ino == st.st_ino &&
+	g->mtime.tv_sec == st.st_mtim.tv_sec &&
+	g->mtime.tv_nsec == st.st_mtim.tv_nsec)
+	return &g->list;
+    if (g == NULL) {
+	if (nglobdirs == GLOBDIRS)
+	    glob_flush();
+	if ((g = calloc(1, sizeof(*g))) == NULL || (g->dir = strdup(dir)) == NULL)
+	    unix_error("glob_dir: malloc");
+	g->next = globtab[h];
+	globtab[h] = g;
+	nglobdirs++;
+    }
+    clock_gettime(CLOCK_REALTIME, &now);
+    dirlist_read(dir, &g->list);
+    g->dev = st.st_dev;
+    g->ino = st.st_ino;
+    g->mtime = st.st_mtim;
+    g->racy = now.tv_sec - st.st_mtim.tv_sec <= 1;
+    return &g->list;
 }
 
-/* getprocessid  - Find a job (by PID) on the job list */
-struct job_t *getprocessid(struct job_t *jobs, pid_t pid) {
+/* glob_flush - Forget every cached directory listing */
+void glob_flush(void)
+{
+    struct globdir_t *g, *next;
     int i;
 
-    if (pid < 1)
-	return NULL;
-    for (i = 0; i < MAXJOBS; i++)
-	if (jobs[i].pid == pid)
-	    return &jobs[i];
-    return NULL;
+    for (i = 0; i < GLOBHASH; i++) {
+	for (g = globtab[i]; g != NULL; g = next) {
+	    next = g->next;
+	    dirlist_free(&g->list);
+	    free(g->dir);
+	    free(g);
+	}
+	globtab[i] = NULL;
+    }
+    nglobdirs = 0;
 }
+/*********************************************
+ * end glob expansion helper routines
+ *********************************************/
 
-/* getjobid  - Find a job (by JID) on the job list */
-struct job_t *getjobid(struct job_t *jobs, int jid) 
+
+/*********************************************
+ * Helper routines for output capture
+ *
+ * A captured job's stdout is a pipe on the event loop. The first
+ * OUTBUF bytes are read into memory; past that everything, those
+ * bytes included, goes to an unlinked file, and the pipe is spliced
+ * straight into it so the data never passes through the shell.
+ *********************************************/
+
+/*
+ * out_attach - Start capturing pipe fd as the output of job jid, led
+ *    by pgid, dropping what an earlier captured job with that ID left
+ */
+struct outbuf_t *out_attach(int jid, pid_t pgid, int fd)
 {
-    int i;
+    struct outbuf_t *o, **pp;
 
-    if (jid < 1)
-	return NULL;
-    for (i = 0; i < MAXJOBS; i++)
-	if (jobs[i].jid == jid)
-	    return &jobs[i];
+    if ((o = out_find(jid)) != NULL)
+	out_free(o);
+    if ((o = calloc(1, sizeof(*o))) == NULL ||
+	(o->buf = malloc(OUTBUF)) == NULL)
+	unix_error("out_attach: malloc");
+    o->jid = jid;
+    o->pgid = pgid;
+    o->fd = fd;
+    o->spill = -1;
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    if ((o->src = ev_add(fd, EPOLLIN, out_ready, o)) == NULL)
+	unix_error("out_attach: epoll_ctl");
+    /* kept in job ID order, for the listing */
+    for (pp = &outbufs; *pp != NULL && (*pp)->jid < jid; pp = &(*pp)->next)
+	;
+    o->next = *pp;
+    *pp = o;
+    return o;
+}
+
+/* out_find - Return the captured output of job jid, or NULL */
+struct outbuf_t *out_find(int jid)
+{
+    struct outbuf_t *o;
+
+    for (o = outbufs; o != NULL; o = o->next)
+	if (o->jid == jid)
+	    return o;
     return NULL;
 }
 
-/* get_jid_from_pid - Map process ID to job ID */
-int get_jid_from_pid(pid_t pid) 
+/*
+ * out_ready - Move everything waiting in a captured job's pipe into
+ *    its buffer or file, and stop watching the pipe at EOF
+ */
+void out_ready(struct evsrc_t *src)
 {
-    int i;
+    struct outbuf_t *o = src->arg;
+    char discard[4096];
+    ssize_t n;
 
-    if (pid < 1)
-	return 0;
-    for (i = 0; i < MAXJOBS; i++)
-	if (jobs[i].pid == pid) {
-            return jobs[i].jid;
-        }
-    return 0;
+    for (;;) {
+	if (o->spill >= 0)
+	    n = splice(o->fd, NULL, o->spill, NULL, 1 << 16,
+		       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+	else if (o->len < OUTBUF)
+	    n = read(o->fd, o->buf + o->len, OUTBUF - o->len);
+	else if (out_spill(o) == 0)
+	    continue;
+	else if ((n = read(o->fd, discard, sizeof(discard))) > 0) {
+	    o->dropped += n;
+	    continue;
+	}
+	if (n > 0) {
+	    o->len += n;
+	    continue;
+	}
+	if (n < 0 && errno == EINTR)
+	    continue;
+	if (n < 0 && errno == EAGAIN)
+	    return;
+	/* EOF, or an error we can't do anything about */
+	ev_del(o->src);
+	close(o->fd);
+	o->fd = -1;
+	return;
+    }
 }
 
-/* showjobs - Print the job list */
-void showjobs(struct job_t *jobs) 
+/*
+ * out_spill - Move a full buffer to an unlinked file in $TMPDIR (or
+ *    /tmp) that the rest of the output will be spliced into. Returns
+ *    -1 if the file can't be made, after saying so.
+ */
+int out_spill(struct outbuf_t *o)
 {
-    int i;
-    
-    for (i = 0; i < MAXJOBS; i++) {
-	if (jobs[i].pid != 0) {
-	    printf("[%d] (%d) ", jobs[i].jid, jobs[i].pid);
-	    switch (jobs[i].state) {
-		case BG: 
-		    printf("Running ");
-		    break;
-		case FG: 
-		    printf("Foreground ");
-		    break;
-		case ST: 
-		    printf("Stopped ");
-		    break;
-	    default:
-		    printf("showjobs: Internal error: job[%d].state=%d ", 
-			   i, jobs[i].state);
-	    }
-	    printf("%s", jobs[i].cmdline);
+    const char *dir = var_get("TMPDIR");
+    char path[PATH_MAX];
+    size_t off;
+    ssize_t n;
+    int fd;
+
+    if (o->dropped > 0)
+	return -1;                      /* already failed */
+    if (dir == NULL || *dir == '\0')
+	dir = "/tmp";
+    if ((fd = open(dir, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600)) < 0) {
+	snprintf(path, sizeof(path), "%s/tsh-outXXXXXX", dir);
+	if ((fd = mkostemp(path, O_CLOEXEC)) >= 0)
+	    unlink(path);
+    }
+    for (off = 0; fd >= 0 && off < o->len; off += n) {
+	if ((n = write(fd, o->buf + off, o->len - off)) < 0) {
+	    close(fd);
+	    fd = -1;
 	}
     }
+    if (fd < 0) {
+	printf("output: [%d] can't keep more than %d bytes: %s\n",
+	       o->jid, OUTBUF, strerror(errno));
+	o->dropped = 1;                 /* counts from here on */
+	return -1;
+    }
+    o->spill = fd;
+    free(o->buf);
+    o->buf = NULL;
+    return 0;
 }
-/******************************
- * end job list helper routines
- ******************************/
+
+/* out_show - Print a job's captured output from byte from onwards */
+void out_show(struct outbuf_t *o, size_t from)
+{
+    char chunk[1 << 16];
+    ssize_t n;
+
+    if (from >= o->len)
+	return;
+    fflush(stdout);
+    if (o->spill < 0) {
+	edit_echo(o->buf + from, o->len - from);
+	return;
+    }
+    for (; from < o->len; from += n) {
+	n = o->len - from < sizeof(chunk) ? o->len - from : sizeof(chunk);
+	if ((n = pread(o->spill, chunk, n, from)) <= 0)
+	    break;
+	edit_echo(chunk, n);
+    }
+}
+
+/* out_free - Forget a job's captured output */
+void out_free(struct outbuf_t *o)
+{
+    struct outbuf_t **pp;
+
+    for (pp = &outbufs; *pp != o; pp = &(*pp)->next)
+	;
+    *pp = o->next;
+    if (o->fd >= 0) {
+	ev_del(o->src);
+	close(o->fd);
+    }
+    if (o->spill >= 0)
+	close(o->spill);
+    free(o->buf);
+    free(o);
+}
+/*********************************************
+ * end output capture helper routines
+ *********************************************/
 
 
 /***********************
@@ -751,10 +6745,14 @@ void showjobs(struct job_t *jobs)
  */
 void usage(void) 
 {
-    printf("Usage: shell [-hvp]\n");
+    printf("Usage: shell [-hvpso] [-b bytes] [script]\n");
     printf("   -h   print this message\n");
     printf("   -v   print additional diagnostic information\n");
     printf("   -p   do not emit a command prompt\n");
+    printf("   -s   launch jobs with posix_spawn instead of fork\n");
+    printf("   -o   keep background jobs' output for the output builtin\n");
+    printf("   -b   size pipeline pipes to hold this many bytes\n");
+    printf("   script  run the commands in this file instead of stdin\n");
     exit(1);
 }
 
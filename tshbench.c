@@ -0,0 +1,376 @@
+/*
+ * tshbench.c - Time how fast the shell starts, waits for and reaps jobs
+ *
+ * usage: tshbench [-t tsh] [-a "tsh args"] [-n count] [-j jobs] [-c bytes]
+ *                 [-o file]
+ *
+ * Drives the shell through a pair of pipes, as sdriver.pl does, and
+ * measures with the monotonic clock:
+ *
+ *   roundtrip  a "./myspin 0; echo" line written to the shell until
+ *              the echo comes back, count times (p50, p99, max)
+ *   builtin    the same for a lone "echo", which the shell runs itself
+ *              (p50, p99)
+ *   spawn      count "./myspin 0" commands written at once, until an
+ *              echo behind them comes back (spawns per second)
+ *   fgwait     the shell's own waitfg wakeup latency, from its -v
+ *              summary after count foreground jobs (avg, max)
+ *   reap       jobs "./myspin 0 &" commands written at once: the time
+ *              from the last job being announced to the last one being
+ *              reaped, and from the first write to the last reap
+ *   capture    jobs background jobs each writing bytes (default 1 MB),
+ *              until the last is reaped: once with their output going
+ *              straight to the shell's stdout, once with the shell
+ *              capturing it (-o)
+ *
+ * The results are printed and also written, one "name value" pair per
+ * line, to file (default bench.out) so runs can be compared.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define MAXSHARGS 16
+#define BUFSIZE   65536
+#define TIMEOUTMS 30000   /* give up on a shell that stops answering */
+
+struct shell_t {
+    pid_t pid;
+    int in, out;            /* the shell's stdin and stdout */
+    char buf[BUFSIZE];      /* output read but not yet consumed */
+    size_t start, end;
+};
+
+char *tshpath = "./tsh";
+char *tshargs[MAXSHARGS];
+int ntshargs;
+
+void shell_start(struct shell_t *sh, const char *flags);
+long capture_burst(const char *flags, long njobs, long bytes, char *text);
+void shell_send(struct shell_t *sh, const char *text, size_t len);
+char *shell_line(struct shell_t *sh);
+char *shell_expect(struct shell_t *sh, const char *prefix);
+void shell_finish(struct shell_t *sh);
+long now_ns(void);
+int cmplong(const void *a, const void *b);
+void unix_error(const char *msg);
+void app_error(const char *msg);
+
+int main(int argc, char **argv)
+{
+    struct shell_t sh;
+    char *outfile = "bench.out", *line, *text, *arg, *p;
+    long count = 1000, njobs = 100, i, *lat, *blat, t0, t1, tspawned = 0;
+    long spawned, reaped, bytes = 1 << 20, plain_ns, captured_ns;
+    double spawn_rate, wake_avg = -1, wake_max = -1;
+    size_t len;
+    FILE *fp;
+    int c;
+
+    while ((c = getopt(argc, argv, "t:a:n:j:c:o:")) != EOF) {
+	switch (c) {
+	case 't':
+	    tshpath = optarg;
+	    break;
+	case 'a':
+	    for (arg = strtok(optarg, " "); arg != NULL && ntshargs < MAXSHARGS - 3;
+		 arg = strtok(NULL, " "))
+		tshargs[ntshargs++] = arg;
+	    break;
+	case 'n':
+	    count = atol(optarg);
+	    break;
+	case 'j':
+	    njobs = atol(optarg);
+	    break;
+	case 'c':
+	    bytes = atol(optarg);
+	    break;
+	case 'o':
+	    outfile = optarg;
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-t tsh] [-a \"tsh args\"] [-n count] "
+		    "[-j jobs] [-c bytes] [-o file]\n", argv[0]);
+	    exit(1);
+	}
+    }
+    if (count < 1 || njobs < 1 || bytes < 1)
+	app_error("count, jobs and bytes must be positive");
+    signal(SIGPIPE, SIG_IGN);
+    if ((lat = malloc(count * sizeof(long))) == NULL ||
+	(blat = malloc(count * sizeof(long))) == NULL ||
+	(text = malloc((count > njobs ? count : njobs) * 64 + 32)) == NULL)
+	unix_error("malloc");
+
+    /* round trips, one command at a time */
+    shell_start(&sh, "-p");
+    for (i = 0; i < count; i++) {
+	len = sprintf(text, "./myspin 0; echo r%ld\n", i);
+	t0 = now_ns();
+	shell_send(&sh, text, len);
+	shell_expect(&sh, text + 17);   /* "r<i>\n" */
+	lat[i] = now_ns() - t0;
+    }
+    qsort(lat, count, sizeof(long), cmplong);
+    for (i = 0; i < count; i++) {
+	len = sprintf(text, "echo b%ld\n", i);
+	t0 = now_ns();
+	shell_send(&sh, text, len);
+	shell_expect(&sh, text + 5);    /* "b<i>\n" */
+	blat[i] = now_ns() - t0;
+    }
+    qsort(blat, count, sizeof(long), cmplong);
+
+    /* spawn throughput, every command written at once */
+    for (i = 0, p = text; i < count; i++)
+	p += sprintf(p, "./myspin 0\n");
+    p += sprintf(p, "echo spawned\n");
+    t0 = now_ns();
+    shell_send(&sh, text, p - text);
+    shell_expect(&sh, "spawned");
+    t1 = now_ns();
+    spawn_rate = (count + 1) / ((t1 - t0) / 1e9);
+    shell_finish(&sh);
+
+    /* reaping a burst of background jobs, then the waitfg summary */
+    shell_start(&sh, "-pv");
+    for (i = 0, p = text; i < njobs; i++)
+	p += sprintf(p, "./myspin 0 &\n");
+    spawned = reaped = 0;
+    t0 = now_ns();
+    shell_send(&sh, text, p - text);
+    while (reaped < njobs) {
+	if ((line = shell_line(&sh)) == NULL)
+	    app_error("shell exited during the reap test");
+	if (line[0] == '[' && strstr(line, "myspin") != NULL) {
+	    if (++spawned == njobs)
+		tspawned = now_ns();
+	} else if (strncmp(line, "Job [", 5) == 0 && strstr(line, "real") != NULL) {
+	    reaped++;
+	}
+    }
+    t1 = now_ns();
+    if (spawned < njobs)
+	tspawned = t1;          /* reaped before the shell announced them */
+    for (i = 0, p = text; i < count / 10 + 1; i++)
+	p += sprintf(p, "./myspin 0\n");
+    shell_send(&sh, text, p - text);
+    close(sh.in);
+    sh.in = -1;
+    while ((line = shell_line(&sh)) != NULL)
+	sscanf(line, "waitfg: %*d waits, avg wakeup %lf us, max %lf us",
+	       &wake_avg, &wake_max);
+    shell_finish(&sh);
+
+    /* background output, inherited and then captured */
+    plain_ns = capture_burst("-pv", njobs, bytes, text);
+    captured_ns = capture_burst("-pvo", njobs, bytes, text);
+
+    if ((fp = fopen(outfile, "w")) == NULL)
+	unix_error(outfile);
+    fprintf(fp, "roundtrip_p50_us %.1f\n", lat[count / 2] / 1e3);
+    fprintf(fp, "roundtrip_p99_us %.1f\n", lat[count * 99 / 100] / 1e3);
+    fprintf(fp, "roundtrip_max_us %.1f\n", lat[count - 1] / 1e3);
+    fprintf(fp, "builtin_p50_us %.1f\n", blat[count / 2] / 1e3);
+    fprintf(fp, "builtin_p99_us %.1f\n", blat[count * 99 / 100] / 1e3);
+    fprintf(fp, "spawns_per_sec %.0f\n", spawn_rate);
+    fprintf(fp, "fgwait_avg_us %.0f\n", wake_avg);
+    fprintf(fp, "fgwait_max_us %.0f\n", wake_max);
+    fprintf(fp, "reap_jobs %ld\n", njobs);
+    fprintf(fp, "reap_drain_ms %.3f\n", (t1 - tspawned) / 1e6);
+    fprintf(fp, "reap_total_ms %.3f\n", (t1 - t0) / 1e6);
+    fprintf(fp, "capture_bytes %ld\n", bytes);
+    fprintf(fp, "inherited_ms %.3f\n", plain_ns / 1e6);
+    fprintf(fp, "captured_ms %.3f\n", captured_ns / 1e6);
+    fclose(fp);
+
+    printf("roundtrip  p50 %.1f us, p99 %.1f us, max %.1f us (%ld commands)\n",
+	   lat[count / 2] / 1e3, lat[count * 99 / 100] / 1e3,
+	   lat[count - 1] / 1e3, count);
+    printf("builtin    p50 %.1f us, p99 %.1f us\n",
+	   blat[count / 2] / 1e3, blat[count * 99 / 100] / 1e3);
+    printf("spawn      %.0f spawns/s\n", spawn_rate);
+    printf("fgwait     avg %.0f us, max %.0f us\n", wake_avg, wake_max);
+    printf("reap       %ld jobs: last reaped %.3f ms after the last start, "
+	   "%.3f ms in all\n", njobs, (t1 - tspawned) / 1e6, (t1 - t0) / 1e6);
+    printf("capture    %ld jobs of %ld bytes: inherited stdout %.3f ms, "
+	   "captured %.3f ms\n", njobs, bytes, plain_ns / 1e6, captured_ns / 1e6);
+    printf("results written to %s\n", outfile);
+    exit(0);
+}
+
+/*
+ * capture_burst - Start njobs background jobs that each write bytes
+ *    of output, in a shell run with flags (which must include -v), and
+ *    return the nanoseconds from the first write until the last job
+ *    is reaped. Whatever the jobs print themselves is read and skipped.
+ */
+long capture_burst(const char *flags, long njobs, long bytes, char *text)
+{
+    struct shell_t sh;
+    long i, reaped = 0, t0, t1;
+    char *line, *p;
+
+    shell_start(&sh, flags);
+    for (i = 0, p = text; i < njobs; i++)
+	p += sprintf(p, "/usr/bin/yes | /usr/bin/head -c %ld &\n", bytes);
+    t0 = now_ns();
+    shell_send(&sh, text, p - text);
+    while (reaped < njobs) {
+	if ((line = shell_line(&sh)) == NULL)
+	    app_error("shell exited during the capture test");
+	if (strncmp(line, "Job [", 5) == 0 && strstr(line, "real") != NULL)
+	    reaped++;
+    }
+    t1 = now_ns();
+    shell_finish(&sh);
+    return t1 - t0;
+}
+
+/*
+ * shell_start - Run the shell under test with flags (-p, and maybe -v
+ *    and others), connected to sh by pipes. stderr goes with stdout,
+ *    as the shell itself arranges.
+ */
+void shell_start(struct shell_t *sh, const char *flags)
+{
+    char *args[MAXSHARGS];
+    int in[2], out[2], i, n = 0;
+
+    if (pipe(in) < 0 || pipe(out) < 0)
+	unix_error("pipe");
+    args[n++] = tshpath;
+    args[n++] = (char *)flags;
+    for (i = 0; i < ntshargs; i++)
+	args[n++] = tshargs[i];
+    args[n] = NULL;
+    if ((sh->pid = fork()) < 0)
+	unix_error("fork");
+    if (sh->pid == 0) {
+	dup2(in[0], 0);
+	dup2(out[1], 1);
+	close(in[0]); close(in[1]);
+	close(out[0]); close(out[1]);
+	execv(tshpath, args);
+	perror(tshpath);
+	exit(1);
+    }
+    close(in[0]);
+    close(out[1]);
+    sh->in = in[1];
+    sh->out = out[0];
+    sh->start = sh->end = 0;
+}
+
+/* shell_send - Write text to the shell's stdin */
+void shell_send(struct shell_t *sh, const char *text, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0) {
+	if ((n = write(sh->in, text, len)) < 0) {
+	    if (errno == EINTR)
+		continue;
+	    unix_error("write to shell");
+	}
+	text += n;
+	len -= n;
+    }
+}
+
+/*
+ * shell_line - Return the next line the shell prints, without its
+ *    newline, or NULL once it has closed its stdout
+ */
+char *shell_line(struct shell_t *sh)
+{
+    struct pollfd pfd;
+    char *line, *nl;
+    ssize_t n;
+
+    for (;;) {
+	line = sh->buf + sh->start;
+	if ((nl = memchr(line, '\n', sh->end - sh->start)) != NULL) {
+	    *nl = '\0';
+	    sh->start = nl + 1 - sh->buf;
+	    return line;
+	}
+	if (sh->start > 0) {
+	    memmove(sh->buf, line, sh->end - sh->start);
+	    sh->end -= sh->start;
+	    sh->start = 0;
+	}
+	if (sh->end == BUFSIZE - 1)
+	    app_error("shell output line too long");
+	pfd.fd = sh->out;
+	pfd.events = POLLIN;
+	if (poll(&pfd, 1, TIMEOUTMS) == 0)
+	    app_error("timed out waiting for the shell");
+	if ((n = read(sh->out, sh->buf + sh->end, BUFSIZE - 1 - sh->end)) < 0) {
+	    if (errno == EINTR)
+		continue;
+	    unix_error("read from shell");
+	}
+	if (n == 0)
+	    return NULL;
+	sh->end += n;
+    }
+}
+
+/* shell_expect - Skip output up to the line starting with prefix */
+char *shell_expect(struct shell_t *sh, const char *prefix)
+{
+    size_t len = strcspn(prefix, "\n");
+    char *line;
+
+    while ((line = shell_line(sh)) != NULL)
+	if (strncmp(line, prefix, len) == 0 && line[len] == '\0')
+	    return line;
+    app_error("shell exited early");
+    return NULL;
+}
+
+/* shell_finish - Close the shell's input and wait for it to exit */
+void shell_finish(struct shell_t *sh)
+{
+    if (sh->in >= 0)
+	close(sh->in);
+    close(sh->out);
+    waitpid(sh->pid, NULL, 0);
+}
+
+/* now_ns - Return the monotonic clock in nanoseconds */
+long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+int cmplong(const void *a, const void *b)
+{
+    long x = *(const long *)a, y = *(const long *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+void unix_error(const char *msg)
+{
+    fprintf(stderr, "tshbench: %s: %s\n", msg, strerror(errno));
+    exit(1);
+}
+
+void app_error(const char *msg)
+{
+    fprintf(stderr, "tshbench: %s\n", msg);
+    exit(1);
+}